@@ -6,646 +6,1370 @@
 #include <unordered_set>
 #include <iomanip>
 #include <sstream>
-#include <map>
-#include <unordered_map>
 #include <fstream>
+#include <charconv>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#include "PokerSimulator.h"
+#include "ThreadAffinity.h"
+#include "PerfCounters.h"
+#include "Pipeline.h"
+#include "SharedQueues.h"
 
 using namespace std;
 
-// Enumerations for Suit and Rank
-enum Suit { HEARTS, DIAMONDS, CLUBS, SPADES };
-enum Rank {
-    TWO = 2, THREE, FOUR, FIVE, SIX, SEVEN,
-    EIGHT, NINE, TEN, JACK, QUEEN, KING, ACE
-};
+// Coverage generation: equity does not change when suits are relabelled, so spots
+// are drawn per suit-isomorphism class and stages are taken round-robin.
 
-// Structure to represent a Card
-struct Card {
-    Suit suit;
-    Rank rank;
+// Class to generate spots by walking suit-isomorphism classes
+class CoverageSpotGenerator {
+private:
+    struct SpotClass {
+        SpotKey key;
+        double weight; // Number of raw spots in the class
+    };
 
-    Card(Suit s, Rank r) : suit(s), rank(r) {}
+    static constexpr int STAGE_COUNT = 4;
+    static constexpr int MAX_DUPLICATE_RETRIES = 64;
 
-    // Overload == operator for comparison
-    bool operator==(const Card& other) const {
-        return (suit == other.suit) && (rank == other.rank);
-    }
-};
+    bool weighted;
+    mt19937& rng;
+    long long generated = 0;
 
-// Function to convert Card object to string
-string cardToString(const Card& card) {
-    string rankStr;
-    switch (card.rank) {
-    case TWO: rankStr = "2"; break;
-    case THREE: rankStr = "3"; break;
-    case FOUR: rankStr = "4"; break;
-    case FIVE: rankStr = "5"; break;
-    case SIX: rankStr = "6"; break;
-    case SEVEN: rankStr = "7"; break;
-    case EIGHT: rankStr = "8"; break;
-    case NINE: rankStr = "9"; break;
-    case TEN: rankStr = "10"; break;
-    case JACK: rankStr = "J"; break;
-    case QUEEN: rankStr = "Q"; break;
-    case KING: rankStr = "K"; break;
-    case ACE: rankStr = "A"; break;
-    }
-
-    string suitStr;
-    switch (card.suit) {
-    case HEARTS: suitStr = "h"; break;
-    case DIAMONDS: suitStr = "d"; break;
-    case CLUBS: suitStr = "c"; break;
-    case SPADES: suitStr = "s"; break;
-    }
-
-    return rankStr + suitStr;
-}
+    // Preflop matchup classes (stage 0) and board classes (stages 1-3)
+    vector<SpotClass> classes[STAGE_COUNT];
+    size_t cursor[STAGE_COUNT] = { 0, 0, 0, 0 };
+    discrete_distribution<size_t> classDistribution[STAGE_COUNT];
+    bool built[STAGE_COUNT] = { false, false, false, false };
 
-// Struct to represent evaluated hand value
-struct HandValue {
-    int category; // 1 to 9
-    vector<int> tiebreakers; // For comparing hands within the same category
+    unordered_set<SpotKey, SpotKeyHash> seen;
 
-    bool operator<(const HandValue& other) const {
-        if (category != other.category)
-            return category < other.category;
-        for (size_t i = 0; i < tiebreakers.size(); ++i) {
-            if (i >= other.tiebreakers.size())
-                return false;
-            if (tiebreakers[i] != other.tiebreakers[i])
-                return tiebreakers[i] < other.tiebreakers[i];
+public:
+    CoverageSpotGenerator(bool weightedMode, mt19937& generator)
+        : weighted(weightedMode), rng(generator) {}
+
+    // Function to produce the next spot; stages are assigned round-robin
+    void next(vector<Card>& player1Hand, vector<Card>& player2Hand, string& gameStage, vector<Card>& communityCards) {
+        static const char* stageNames[STAGE_COUNT] = { "preflop", "flop", "turn", "river" };
+        int stage = static_cast<int>(generated++ % STAGE_COUNT);
+        buildClasses(stage);
+
+        SpotKey spot{};
+        for (int attempt = 0; attempt <= MAX_DUPLICATE_RETRIES; ++attempt) {
+            const SpotClass& cls = classes[stage][pickClass(stage)];
+            if (stage == 0) {
+                spot = cls.key;
+            }
+            else {
+                spot = canonicalSpot(cls.key.board, 0, 0);
+                uint64_t used = spot.board;
+                spot.p1 = drawCards(2, used);
+                spot.p2 = drawCards(2, used);
+                spot = canonicalSpot(spot.board, spot.p1, spot.p2);
+            }
+            // Preflop classes are unique by construction; postflop retry on repeats
+            if (seen.insert(spot).second || stage == 0)
+                break;
         }
-        return false;
+
+        player1Hand = cardsFromMask(spot.p1);
+        player2Hand = cardsFromMask(spot.p2);
+        communityCards = cardsFromMask(spot.board);
+        gameStage = stageNames[stage];
     }
 
-    bool operator>(const HandValue& other) const {
-        return other < *this;
+private:
+    size_t pickClass(int stage) {
+        if (weighted)
+            return classDistribution[stage](rng);
+        // Systematic: every class once per pass, in a fresh random order
+        if (cursor[stage] == classes[stage].size()) {
+            shuffle(classes[stage].begin(), classes[stage].end(), rng);
+            cursor[stage] = 0;
+        }
+        return cursor[stage]++;
     }
 
-    bool operator==(const HandValue& other) const {
-        return (category == other.category) && (tiebreakers == other.tiebreakers);
+    // Function to draw distinct cards not in used (and mark them used)
+    uint64_t drawCards(int count, uint64_t& used) {
+        uniform_int_distribution<int> cardDist(0, 51);
+        uint64_t drawn = 0;
+        while (count > 0) {
+            uint64_t bit = uint64_t(1) << cardDist(rng);
+            if (used & bit) continue;
+            used |= bit;
+            drawn |= bit;
+            count--;
+        }
+        return drawn;
     }
-};
 
-// Deck class to manage cards
-class Deck {
-public:
-    vector<Card> cards;
-
-    Deck(const vector<Card>& excludedCards) {
-        // Initialize full deck
-        for (int s = HEARTS; s <= SPADES; ++s) {
-            for (int r = TWO; r <= ACE; ++r) {
-                Card card(static_cast<Suit>(s), static_cast<Rank>(r));
-                // Check if card is excluded
-                bool excluded = false;
-                for (const auto& ec : excludedCards) {
-                    if (card == ec) {
-                        excluded = true;
-                        break;
+    void buildClasses(int stage) {
+        if (built[stage])
+            return;
+        built[stage] = true;
+
+        unordered_map<SpotKey, double, SpotKeyHash> counts;
+        if (stage == 0) {
+            // Count the raw hands behind each canonical Player 1 hand (169 classes)
+            unordered_map<uint64_t, double> handClasses;
+            for (int a = 0; a < 52; ++a)
+                for (int b = a + 1; b < 52; ++b)
+                    handClasses[canonicalSpot(0, (uint64_t(1) << a) | (uint64_t(1) << b), 0).p1] += 1.0;
+            // Pair each representative with every disjoint Player 2 hand; a
+            // relabelling maps any raw Player 1 hand onto its representative
+            for (const auto& hand : handClasses) {
+                for (int c = 0; c < 52; ++c)
+                    for (int d = c + 1; d < 52; ++d) {
+                        uint64_t p2 = (uint64_t(1) << c) | (uint64_t(1) << d);
+                        if (hand.first & p2) continue;
+                        counts[canonicalSpot(0, hand.first, p2)] += hand.second;
                     }
-                }
-                if (!excluded)
-                    cards.push_back(card);
             }
         }
+        else {
+            // Every board of 3, 4 or 5 cards
+            int boardSize = stage + 2;
+            vector<int> idx(boardSize);
+            for (int i = 0; i < boardSize; ++i) idx[i] = i;
+            while (true) {
+                uint64_t board = 0;
+                for (int i : idx) board |= uint64_t(1) << i;
+                counts[canonicalSpot(board, 0, 0)] += 1.0;
+
+                int i = boardSize - 1;
+                while (i >= 0 && idx[i] == 52 - boardSize + i) --i;
+                if (i < 0) break;
+                idx[i]++;
+                for (int j = i + 1; j < boardSize; ++j) idx[j] = idx[j - 1] + 1;
+            }
+        }
+
+        classes[stage].reserve(counts.size());
+        for (const auto& entry : counts)
+            classes[stage].push_back({ entry.first, entry.second });
+        // Fixed order first so runs with the same seed are reproducible
+        sort(classes[stage].begin(), classes[stage].end(), [](const SpotClass& a, const SpotClass& b) {
+            return a.key < b.key;
+            });
+        shuffle(classes[stage].begin(), classes[stage].end(), rng);
+
+        vector<double> weights;
+        weights.reserve(classes[stage].size());
+        for (const auto& cls : classes[stage]) weights.push_back(cls.weight);
+        classDistribution[stage] = discrete_distribution<size_t>(weights.begin(), weights.end());
+        cout << "Coverage: " << classes[stage].size() << " canonical " << stageNames(stage) << " classes.\n";
     }
 
-    void shuffleDeck() {
-        random_device rd;
-        mt19937 g(rd());
-        shuffle(cards.begin(), cards.end(), g);
+    static const char* stageNames(int stage) {
+        static const char* names[STAGE_COUNT] = { "preflop matchup", "flop board", "turn board", "river board" };
+        return names[stage];
     }
 };
 
-// HandEvaluator class to evaluate poker hands
-class HandEvaluator {
+// WorkStealingScheduler class to run rows of very different cost: each worker pops its
+// own newest task and steals another worker's oldest one when it runs out.
+
+class WorkStealingScheduler {
+private:
+    // Each worker's deque sits on its own cache line
+    struct alignas(64) WorkerQueue {
+        mutex mtx;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> threads;
+    atomic<long long> unfinished{ 0 }; // Submitted but not yet completed
+    atomic<long long> queued{ 0 };     // Sitting in some deque
+    atomic<size_t> nextQueue{ 0 };
+    mutex sleepMtx;
+    condition_variable workAvailable;
+    condition_variable allDone;
+    bool stopping = false;
+
+    // Index of the worker running on this thread, -1 elsewhere
+    static inline thread_local int workerIndex = -1;
+
 public:
-    // Map-based hand evaluation
-    HandValue evaluateHandMap(const vector<Card>& hand) {
-        // Use std::map for counting
-        map<int, int> rankCount;
-        map<Suit, int> suitCount;
-        return evaluateHandGeneric(hand, rankCount, suitCount);
+    // Workers are pinned node by node when a topology is given
+    WorkStealingScheduler(int numThreads, const CpuTopology* pinTopology) {
+        for (int i = 0; i < numThreads; ++i)
+            queues.push_back(make_unique<WorkerQueue>());
+        for (int i = 0; i < numThreads; ++i)
+            threads.emplace_back(&WorkStealingScheduler::workerLoop, this, i, pinTopology);
     }
 
-    // Hash table-based hand evaluation
-    HandValue evaluateHandHash(const vector<Card>& hand) {
-        // Use std::unordered_map for counting
-        unordered_map<int, int> rankCount;
-        unordered_map<Suit, int> suitCount;
-        return evaluateHandGeneric(hand, rankCount, suitCount);
+    ~WorkStealingScheduler() {
+        {
+            lock_guard<mutex> lock(sleepMtx);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    // Function to queue a task; from a worker it goes on that worker's own
+    // deque, otherwise the deques are filled round-robin
+    void submit(function<void()> task) {
+        unfinished++;
+        size_t index = workerIndex >= 0 ? static_cast<size_t>(workerIndex) : nextQueue++ % queues.size();
+        {
+            lock_guard<mutex> lock(queues[index]->mtx);
+            queues[index]->tasks.push_back(move(task));
+        }
+        queued++;
+        {
+            lock_guard<mutex> lock(sleepMtx);
+        }
+        workAvailable.notify_one();
+    }
+
+    // Function to block until every submitted task has finished
+    void waitIdle() {
+        unique_lock<mutex> lock(sleepMtx);
+        allDone.wait(lock, [&] { return unfinished == 0; });
     }
 
 private:
-    template<typename RankMap, typename SuitMap>
-    HandValue evaluateHandGeneric(const vector<Card>& hand, RankMap& rankCount, SuitMap& suitCount) {
-        // Sort the hand by rank descending
-        vector<Card> sortedHand = hand;
-        sort(sortedHand.begin(), sortedHand.end(), [&](const Card& a, const Card& b) {
-            return a.rank > b.rank;
-            });
+    bool popLocal(int self, function<void()>& task) {
+        WorkerQueue& q = *queues[self];
+        lock_guard<mutex> lock(q.mtx);
+        if (q.tasks.empty()) return false;
+        task = move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
 
-        vector<int> ranks;
-        for (const auto& card : sortedHand) {
-            rankCount[card.rank]++;
-            suitCount[card.suit]++;
-            ranks.push_back(card.rank);
+    bool steal(int self, function<void()>& task) {
+        int n = static_cast<int>(queues.size());
+        for (int k = 1; k < n; ++k) {
+            WorkerQueue& q = *queues[(self + k) % n];
+            lock_guard<mutex> lock(q.mtx);
+            if (q.tasks.empty()) continue;
+            task = move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
         }
+        return false;
+    }
 
-        bool isFlush = false;
-        Suit flushSuit;
-        for (const auto& sc : suitCount) {
-            if (sc.second >= 5) {
-                isFlush = true;
-                flushSuit = sc.first;
-                break;
+    void workerLoop(int self, const CpuTopology* pinTopology) {
+        workerIndex = self;
+        if (pinTopology && !pinCurrentThread(*pinTopology, self))
+            cerr << "Failed to pin worker " << self << endl;
+        while (true) {
+            function<void()> task;
+            if (popLocal(self, task) || steal(self, task)) {
+                queued--;
+                task();
+                if (--unfinished == 0) {
+                    lock_guard<mutex> lock(sleepMtx);
+                    allDone.notify_all();
+                }
+                continue;
             }
+            unique_lock<mutex> lock(sleepMtx);
+            workAvailable.wait(lock, [&] { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+                return;
         }
+    }
+};
+
+// Trials per stealable chunk when a row is split
+const int TRIALS_PER_CHUNK = 2000;
+
+// Structure to hold one backend's totals for a row. Chunks count into
+// locals and add here once; each backend gets its own cache line so chunks
+// of different backends finishing on different cores do not false-share.
+struct alignas(64) BackendTotals {
+    // 64-bit, as cached rows report pooled counts that grow across runs
+    atomic<long long> p1Wins{ 0 };
+    atomic<long long> p2Wins{ 0 };
+    atomic<long long> ties{ 0 };
+    atomic<long long> execMicros{ 0 };
+
+    // Hardware counter totals when profiling; a bit is set in
+    // perfUnavailable for each event some chunk could not count
+    atomic<long long> perfCounts[PERF_EVENT_COUNT] = {};
+    atomic<int> perfUnavailable{ 0 };
+};
+
+// Structure to represent one dataset row and its accumulated results
+struct DatasetRow {
+    int simID = 0;
+    vector<Card> player1Hand;
+    vector<Card> player2Hand;
+    vector<Card> communityCards;
+    string gameStage;
+
+    // Outcome counts and time per backend (indexed by EvaluatorBackend), summed over chunks
+    BackendTotals totals[EVAL_BACKEND_COUNT];
+
+    // Final hand categories of each player, counted with the first backend
+    // when requested; counts[player][category - 1]
+    atomic<long long> categories[2][HAND_CATEGORY_COUNT] = {};
+
+    // Set when the equity cache already answered the row
+    bool fromCache = false;
+    CachedEquity cached;
+
+    // Simulation chunks still running, and the formatted CSV line
+    atomic<int> pendingChunks{ 0 };
+    string text;
+};
+
+// Function to fill a row with a random spot: a random stage, then both
+// hands and the board dealt without replacement by one partial shuffle
+void generateRandomSpot(DatasetRow& row, BulkCardDealer& dealer) {
+    static const char* const stageNames[4] = { "preflop", "flop", "turn", "river" };
+    static const int boardSizes[4] = { 0, 3, 4, 5 };
+    int stage = static_cast<int>(dealer.below(4));
+    int cardsNeeded = 4 + boardSizes[stage];
+
+    uint8_t picks[9];
+    dealer.deal(picks, 1, cardsNeeded, 52);
+    int deck[52];
+    for (int i = 0; i < 52; ++i) deck[i] = i;
+    for (int c = 0; c < cardsNeeded; ++c) swap(deck[c], deck[picks[c]]);
+
+    row.player1Hand = { cardFromIndex(deck[0]), cardFromIndex(deck[1]) };
+    row.player2Hand = { cardFromIndex(deck[2]), cardFromIndex(deck[3]) };
+    row.communityCards.clear();
+    for (int c = 4; c < cardsNeeded; ++c) row.communityCards.push_back(cardFromIndex(deck[c]));
+    row.gameStage = stageNames[stage];
+}
+
+// Function to run one chunk of a row's trials with the given backend,
+// optionally counting the players' hand categories
+void runRowChunk(DatasetRow& row, EvaluatorBackend backend, int trials, bool profile, bool countCategories) {
+    Simulator simulator(row.player1Hand, row.player2Hand, row.gameStage, row.communityCards);
+    int p1Wins = 0, p2Wins = 0, ties = 0;
+    CategoryHistogram categories;
+    PerfSample perfStart;
+    if (profile) perfStart = PerfCounters::forThisThread().read();
+    auto startTime = chrono::high_resolution_clock::now();
+    simulator.runTrials(backend, trials, p1Wins, p2Wins, ties, countCategories ? &categories : nullptr);
+    auto endTime = chrono::high_resolution_clock::now();
+
+    if (countCategories) {
+        for (int p = 0; p < 2; ++p)
+            for (int c = 0; c < HAND_CATEGORY_COUNT; ++c) row.categories[p][c] += categories.counts[p][c];
+    }
 
-        // Extract ranks for straight
-        vector<int> uniqueRanks;
-        for (const auto& rc : rankCount) {
-            uniqueRanks.push_back(rc.first);
+    BackendTotals& totals = row.totals[backend];
+    totals.p1Wins += p1Wins;
+    totals.p2Wins += p2Wins;
+    totals.ties += ties;
+    totals.execMicros += chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
+
+    if (profile) {
+        PerfSample perf = PerfCounters::forThisThread().read() - perfStart;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            if (perf.available[e]) totals.perfCounts[e] += perf.counts[e];
+            else totals.perfUnavailable |= 1 << e;
         }
-        sort(uniqueRanks.begin(), uniqueRanks.end(), greater<int>());
+    }
+}
 
-        // Check for straight (including Ace-low)
-        bool isStraight = false;
-        int highStraight = 0;
-        if (uniqueRanks.size() >= 5) {
-            for (size_t i = 0; i <= uniqueRanks.size() - 5; ++i) {
-                bool consecutive = true;
-                for (size_t j = 0; j < 4; ++j) {
-                    if (uniqueRanks[i + j] - 1 != uniqueRanks[i + j + 1]) {
-                        consecutive = false;
-                        break;
-                    }
-                }
-                if (consecutive) {
-                    isStraight = true;
-                    highStraight = uniqueRanks[i];
-                    break;
-                }
-            }
-            // Check for Ace-low straight
-            if (!isStraight) {
-                // A, 2, 3, 4, 5
-                if (find(uniqueRanks.begin(), uniqueRanks.end(), ACE) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), TWO) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), THREE) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), FOUR) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), FIVE) != uniqueRanks.end()) {
-                    isStraight = true;
-                    highStraight = FIVE;
-                }
-            }
+// Function to answer a row from the equity cache when it holds an exact
+// result or at least as many trials as requested
+bool answerFromCache(DatasetRow& row, const Simulator& probe, int trials, const EquityCache* cache) {
+    row.fromCache = cache && cache->lookup(probe.spotKey(), row.cached) &&
+        (row.cached.exact || row.cached.trials >= static_cast<uint64_t>(trials));
+    return row.fromCache;
+}
+
+// Function to pool a simulated row's fresh counts into the cache; a cached
+// row instead reports the stored estimate for every backend with zero time
+void poolRowResults(DatasetRow& row, int trials, const vector<EvaluatorBackend>& backends, EquityCache& cache) {
+    if (row.fromCache) {
+        for (EvaluatorBackend backend : backends) {
+            BackendTotals& totals = row.totals[backend];
+            totals.p1Wins = static_cast<long long>(row.cached.p1Wins);
+            totals.p2Wins = static_cast<long long>(row.cached.p2Wins);
+            totals.ties = static_cast<long long>(row.cached.ties);
         }
+    }
+    else if (cache.isOpen()) {
+        CachedEquity add, merged;
+        for (EvaluatorBackend backend : backends) {
+            const BackendTotals& totals = row.totals[backend];
+            add.p1Wins += totals.p1Wins;
+            add.p2Wins += totals.p2Wins;
+            add.ties += totals.ties;
+            add.trials += trials;
+        }
+        Simulator keySource(row.player1Hand, row.player2Hand, row.gameStage, row.communityCards);
+        cache.merge(keySource.spotKey(), add, merged);
+    }
+}
 
-        // Check for straight flush
-        bool isStraightFlush = false;
-        int highStraightFlush = 0;
-        if (isFlush) {
-            // Extract cards of the flush suit
-            vector<Card> flushCards;
-            for (const auto& card : sortedHand) {
-                if (card.suit == flushSuit)
-                    flushCards.push_back(card);
-            }
-            // Check for straight in flushCards
-            vector<int> flushRanks;
-            unordered_map<int, int> flushRankCount;
-            for (const auto& card : flushCards) {
-                flushRankCount[card.rank]++;
-                flushRanks.push_back(card.rank);
+// Function to simulate a row with each selected backend; rows with runouts
+// to deal and more than one chunk of trials leave all but their last chunk
+// for other workers to steal. Rows the equity cache can answer are not
+// simulated at all. Categories are counted with the first backend when
+// requested. onComplete is called once, by whichever thread finishes the
+// row's last chunk.
+void simulateRow(DatasetRow& row, int trials, const vector<EvaluatorBackend>& backends, WorkStealingScheduler& scheduler,
+    const EquityCache* cache, bool profile, bool categories, const function<void(DatasetRow&)>& onComplete) {
+    Simulator probe(row.player1Hand, row.player2Hand, row.gameStage, row.communityCards);
+    if (answerFromCache(row, probe, trials, cache)) {
+        onComplete(row);
+        return;
+    }
+    bool split = probe.neededCommunityCards() > 0 && trials > TRIALS_PER_CHUNK;
+    int chunksPerBackend = split ? (trials + TRIALS_PER_CHUNK - 1) / TRIALS_PER_CHUNK : 1;
+    row.pendingChunks = static_cast<int>(backends.size()) * chunksPerBackend;
+    auto finishChunk = [&row, &onComplete] {
+        if (--row.pendingChunks == 0) onComplete(row);
+        };
+    for (EvaluatorBackend backend : backends) {
+        bool countCategories = categories && backend == backends.front();
+        if (!split) {
+            runRowChunk(row, backend, trials, profile, countCategories);
+            finishChunk();
+            continue;
+        }
+        for (int start = 0; start < trials; start += TRIALS_PER_CHUNK) {
+            int count = min(TRIALS_PER_CHUNK, trials - start);
+            if (backend == backends.back() && start + TRIALS_PER_CHUNK >= trials) {
+                runRowChunk(row, backend, count, profile, countCategories);
+                finishChunk();
             }
-            sort(flushRanks.begin(), flushRanks.end(), greater<int>());
-            // Remove duplicates
-            flushRanks.erase(unique(flushRanks.begin(), flushRanks.end()), flushRanks.end());
-
-            if (flushRanks.size() >= 5) {
-                for (size_t i = 0; i <= flushRanks.size() - 5; ++i) {
-                    bool consecutive = true;
-                    for (size_t j = 0; j < 4; ++j) {
-                        if (flushRanks[i + j] - 1 != flushRanks[i + j + 1]) {
-                            consecutive = false;
-                            break;
-                        }
-                    }
-                    if (consecutive) {
-                        isStraightFlush = true;
-                        highStraightFlush = flushRanks[i];
-                        break;
-                    }
-                }
-                // Check for Ace-low straight flush
-                if (!isStraightFlush) {
-                    if (find(flushRanks.begin(), flushRanks.end(), ACE) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), TWO) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), THREE) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), FOUR) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), FIVE) != flushRanks.end()) {
-                        isStraightFlush = true;
-                        highStraightFlush = FIVE;
-                    }
-                }
+            else {
+                scheduler.submit([&row, backend, count, profile, countCategories, finishChunk] {
+                    runRowChunk(row, backend, count, profile, countCategories);
+                    finishChunk();
+                    });
             }
         }
+    }
+}
+
+// CsvRowFormatter class to format dataset rows into text, using
+// precomputed card strings and to_chars for numbers
+class CsvRowFormatter {
+private:
+    // "2h ", "10h ", ... indexed by cardIndex
+    char cardText[52][4];
+    uint8_t cardTextLength[52];
+
+public:
+    CsvRowFormatter() {
+        for (int i = 0; i < 52; ++i) {
+            string text = cardToString(cardFromIndex(i)) + " ";
+            memcpy(cardText[i], text.data(), text.size());
+            cardTextLength[i] = static_cast<uint8_t>(text.size());
+        }
+    }
+
+    static void appendInt(string& out, long long value) {
+        char buffer[32];
+        out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+    }
+
+    // Same text as ostream's default formatting (%g, 6 significant digits)
+    static void appendDouble(string& out, double value) {
+        char buffer[64];
+        out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value, chars_format::general, 6).ptr - buffer);
+    }
 
-        // Determine hand category and tiebreakers
-        HandValue hv;
-        if (isStraightFlush) {
-            hv.category = 9; // Straight Flush
-            hv.tiebreakers.push_back(highStraightFlush);
+    // Function to append cards as a quoted, space-terminated list ("As Kd ")
+    void appendCards(string& out, const vector<Card>& cards) const {
+        out += '"';
+        for (const auto& card : cards) {
+            int index = cardIndex(card);
+            out.append(cardText[index], cardTextLength[index]);
         }
-        else {
-            // Check for Four of a Kind
-            bool fourKind = false;
-            int fourRank = 0;
-            for (const auto& rc : rankCount) {
-                if (rc.second == 4) {
-                    fourKind = true;
-                    fourRank = rc.first;
-                    break;
-                }
+        out += '"';
+    }
+
+    // Function to format a simulated row as one CSV line. withTrials adds the
+    // trial count behind the row's percentages (pooled or exact when cached).
+    void formatRow(DatasetRow& row, int trialsPerSimulation, const vector<EvaluatorBackend>& backends, bool profile, bool categories, bool withTrials) const {
+        string& out = row.text;
+        out.clear();
+        double trials = row.fromCache ? static_cast<double>(row.cached.trials) : static_cast<double>(trialsPerSimulation);
+        appendInt(out, row.simID);
+        out += ',';
+        appendCards(out, row.player1Hand);
+        out += ',';
+        appendCards(out, row.player2Hand);
+        out += ',';
+        out += row.gameStage;
+        out += ',';
+        appendCards(out, row.communityCards);
+        // Results of each backend, in the order they were selected
+        for (EvaluatorBackend backend : backends) {
+            const BackendTotals& totals = row.totals[backend];
+            for (long long count : { totals.p1Wins.load(), totals.p2Wins.load(), totals.ties.load() }) {
+                out += ',';
+                appendDouble(out, (count / trials) * 100.0);
             }
-            if (fourKind) {
-                hv.category = 8; // Four of a Kind
-                hv.tiebreakers.push_back(fourRank);
-                // Add highest kicker
-                for (const auto& card : sortedHand) {
-                    if (card.rank != fourRank) {
-                        hv.tiebreakers.push_back(card.rank);
-                        break;
-                    }
-                }
+            out += ',';
+            appendInt(out, totals.execMicros / 1000);
+            if (!profile) continue;
+            // Per-trial counts; left empty for cached rows and missing events
+            for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+                out += ',';
+                if (row.fromCache || (totals.perfUnavailable & (1 << e))) continue;
+                appendDouble(out, totals.perfCounts[e] / static_cast<double>(trialsPerSimulation));
             }
-            else {
-                // Check for Full House
-                bool threeKind = false;
-                int threeRank = 0;
-                vector<int> pairs;
-                for (const auto& rc : rankCount) {
-                    if (rc.second == 3) {
-                        if (!threeKind || rc.first > threeRank) {
-                            threeKind = true;
-                            threeRank = rc.first;
-                        }
-                    }
-                    else if (rc.second == 2) {
-                        pairs.push_back(rc.first);
-                    }
-                }
-                if (threeKind && (pairs.size() >= 1 || (threeRank && rankCount.size() >= 2))) {
-                    hv.category = 7; // Full House
-                    hv.tiebreakers.push_back(threeRank);
-                    // Find the highest pair
-                    int highestPair = 0;
-                    for (const auto& pr : pairs) {
-                        if (pr > highestPair) highestPair = pr;
-                    }
-                    // If no pairs, find second three of a kind
-                    if (highestPair == 0) {
-                        for (const auto& rc : rankCount) {
-                            if (rc.second == 3 && rc.first != threeRank) {
-                                if (rc.first > highestPair) highestPair = rc.first;
-                            }
-                        }
-                    }
-                    hv.tiebreakers.push_back(highestPair);
-                }
-                else {
-                    // Check for Flush
-                    if (isFlush) {
-                        hv.category = 6; // Flush
-                        // Add top five cards of flush
-                        int count = 0;
-                        for (const auto& card : sortedHand) {
-                            if (card.suit == flushSuit) {
-                                hv.tiebreakers.push_back(card.rank);
-                                count++;
-                                if (count == 5) break;
-                            }
-                        }
-                    }
-                    else {
-                        // Check for Straight
-                        if (isStraight) {
-                            hv.category = 5; // Straight
-                            hv.tiebreakers.push_back(highStraight);
-                        }
-                        else {
-                            // Check for Three of a Kind
-                            if (threeKind) {
-                                hv.category = 4; // Three of a Kind
-                                hv.tiebreakers.push_back(threeRank);
-                                // Add two highest kickers
-                                int kickers = 0;
-                                for (const auto& card : sortedHand) {
-                                    if (card.rank != threeRank) {
-                                        hv.tiebreakers.push_back(card.rank);
-                                        kickers++;
-                                        if (kickers == 2) break;
-                                    }
-                                }
-                            }
-                            else {
-                                // Check for Two Pair
-                                vector<int> pairsFound;
-                                for (const auto& rc : rankCount) {
-                                    if (rc.second == 2) {
-                                        pairsFound.push_back(rc.first);
-                                    }
-                                }
-                                if (pairsFound.size() >= 2) {
-                                    hv.category = 3; // Two Pair
-                                    sort(pairsFound.begin(), pairsFound.end(), greater<int>());
-                                    hv.tiebreakers.push_back(pairsFound[0]);
-                                    hv.tiebreakers.push_back(pairsFound[1]);
-                                    // Add highest kicker
-                                    for (const auto& card : sortedHand) {
-                                        if (card.rank != pairsFound[0] && card.rank != pairsFound[1]) {
-                                            hv.tiebreakers.push_back(card.rank);
-                                            break;
-                                        }
-                                    }
-                                }
-                                else {
-                                    // Check for One Pair
-                                    if (pairsFound.size() == 1) {
-                                        hv.category = 2; // One Pair
-                                        hv.tiebreakers.push_back(pairsFound[0]);
-                                        // Add three highest kickers
-                                        int kickers = 0;
-                                        for (const auto& card : sortedHand) {
-                                            if (card.rank != pairsFound[0]) {
-                                                hv.tiebreakers.push_back(card.rank);
-                                                kickers++;
-                                                if (kickers == 3) break;
-                                            }
-                                        }
-                                    }
-                                    else {
-                                        // High Card
-                                        hv.category = 1; // High Card
-                                        // Add top five cards
-                                        for (int i = 0; i < 5 && i < sortedHand.size(); ++i) {
-                                            hv.tiebreakers.push_back(sortedHand[i].rank);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
+        }
+        if (withTrials) {
+            out += ',';
+            appendInt(out, row.fromCache ? static_cast<long long>(row.cached.trials) : trialsPerSimulation);
+        }
+        // Share of trials ending in each category per player; left empty for cached rows
+        if (categories) {
+            for (const auto& player : row.categories) {
+                for (const auto& count : player) {
+                    out += ',';
+                    if (!row.fromCache) appendDouble(out, (count / static_cast<double>(trialsPerSimulation)) * 100.0);
                 }
             }
         }
-
-        return hv;
+        out += '\n';
     }
 };
 
-// Simulator class to perform Monte Carlo simulations
-class Simulator {
+// Buffered CSV writer for the dataset. Formatted rows are copied into a
+// large block buffer and whole blocks are handed to a background thread, so
+// filling the next block overlaps the write() of the previous one. With
+// directIO the file is opened with O_DIRECT and only block-aligned writes
+// are issued.
+class DatasetRowWriter {
 private:
-    vector<Card> player1Hand;
-    vector<Card> player2Hand;
-    vector<Card> communityCards;
-    string gameStage;
-    HandEvaluator evaluator;
+    static constexpr size_t IO_ALIGNMENT = 4096;
+
+    size_t blockSize;
+    char* buffers[2] = { nullptr, nullptr };
+    int active = 0;
+    size_t used = 0;
+    int fd = -1;
+    bool directIO = false;
+    bool failed = false;
+    long long bytesWritten = 0; // Logical file size, excluding O_DIRECT padding
+
+    // Background flush state
+    thread flusher;
+    mutex mtx;
+    condition_variable cv;
+    char* pendingData = nullptr;
+    size_t pendingSize = 0;
+    bool stopping = false;
 
 public:
-    Simulator(const vector<Card>& p1Hand, const vector<Card>& p2Hand, const string& stage, const vector<Card>& commCards)
-        : player1Hand(p1Hand), player2Hand(p2Hand), gameStage(stage), communityCards(commCards) {}
-
-    // Function to get all used cards (players' hands and community cards)
-    vector<Card> getAllUsedCards() const {
-        vector<Card> used = player1Hand;
-        used.insert(used.end(), player2Hand.begin(), player2Hand.end());
-        used.insert(used.end(), communityCards.begin(), communityCards.end());
-        return used;
-    }
-
-    // Function to determine how many community cards are needed based on game stage
-    int neededCommunityCards() const {
-        if (gameStage == "preflop") return 5;
-        else if (gameStage == "flop") return 2;
-        else if (gameStage == "turn") return 1;
-        else if (gameStage == "river") return 0;
-        else return 0;
-    }
-
-    // Function to run map-based simulation
-    void runSimulationMap(int trials, double& p1Win, double& p2Win, double& tie, long long& execTime) {
-        int p1Wins = 0, p2Wins = 0, ties = 0;
-        auto startTime = chrono::high_resolution_clock::now();
-
-        for (int i = 0; i < trials; ++i) {
-            // Initialize deck
-            Deck deck(getAllUsedCards());
-            deck.shuffleDeck();
-
-            // Deal needed community cards
-            vector<Card> simCommunity = communityCards;
-            int cardsToDeal = neededCommunityCards();
-            for (int c = 0; c < cardsToDeal; ++c) {
-                if (deck.cards.empty()) break; // Safety check
-                simCommunity.push_back(deck.cards.back());
-                deck.cards.pop_back();
-            }
+    explicit DatasetRowWriter(size_t block = 4 << 20)
+        : blockSize((block + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT) {}
 
-            // Evaluate hands using map
-            vector<Card> p1Total = player1Hand;
-            p1Total.insert(p1Total.end(), simCommunity.begin(), simCommunity.end());
-            vector<Card> p2Total = player2Hand;
-            p2Total.insert(p2Total.end(), simCommunity.begin(), simCommunity.end());
+    ~DatasetRowWriter() {
+        close();
+    }
 
-            HandValue hv1 = evaluator.evaluateHandMap(p1Total);
-            HandValue hv2 = evaluator.evaluateHandMap(p2Total);
+    // Function to open the output file; falls back to buffered I/O when
+    // the filesystem rejects O_DIRECT
+    bool open(const string& path, bool useDirectIO) {
+        for (int b = 0; b < 2; ++b) {
+            void* mem = nullptr;
+            // One spare alignment unit holds the unaligned tail carried between blocks
+            if (posix_memalign(&mem, IO_ALIGNMENT, blockSize + IO_ALIGNMENT) != 0)
+                return false;
+            buffers[b] = static_cast<char*>(mem);
+        }
 
-            // Compare hands
-            if (hv1 > hv2) p1Wins++;
-            else if (hv2 > hv1) p2Wins++;
-            else ties++;
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+        directIO = false;
+#ifdef O_DIRECT
+        if (useDirectIO) {
+            fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+            directIO = fd >= 0;
         }
+#endif
+        if (fd < 0)
+            fd = ::open(path.c_str(), flags, 0644);
+        if (fd < 0)
+            return false;
+        if (useDirectIO && !directIO)
+            cerr << "O_DIRECT unavailable, using buffered writes." << endl;
+
+        flusher = thread(&DatasetRowWriter::flushLoop, this);
+        return true;
+    }
 
-        auto endTime = chrono::high_resolution_clock::now();
-        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+    bool usingDirectIO() const { return directIO; }
 
-        p1Win = (p1Wins / static_cast<double>(trials)) * 100.0;
-        p2Win = (p2Wins / static_cast<double>(trials)) * 100.0;
-        tie = (ties / static_cast<double>(trials)) * 100.0;
+    // Function to append raw text
+    void appendText(const char* text, size_t length) {
+        ensure(length);
+        memcpy(buffers[active] + used, text, length);
+        used += length;
     }
 
-    // Function to run hash table-based simulation
-    void runSimulationHash(int trials, double& p1Win, double& p2Win, double& tie, long long& execTime) {
-        int p1Wins = 0, p2Wins = 0, ties = 0;
-        auto startTime = chrono::high_resolution_clock::now();
+    void appendText(const string& text) {
+        appendText(text.data(), text.size());
+    }
 
-        for (int i = 0; i < trials; ++i) {
-            // Initialize deck
-            Deck deck(getAllUsedCards());
-            deck.shuffleDeck();
+    void appendChar(char ch) {
+        ensure(1);
+        buffers[active][used++] = ch;
+    }
 
-            // Deal needed community cards
-            vector<Card> simCommunity = communityCards;
-            int cardsToDeal = neededCommunityCards();
-            for (int c = 0; c < cardsToDeal; ++c) {
-                if (deck.cards.empty()) break; // Safety check
-                simCommunity.push_back(deck.cards.back());
-                deck.cards.pop_back();
-            }
+    // Function to write out everything buffered and close the file
+    bool close() {
+        if (fd < 0)
+            return !failed;
+        handOff(true);
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        flusher.join();
+        // Drop the zero padding of the final O_DIRECT block
+        if (directIO && ftruncate(fd, bytesWritten) != 0)
+            failed = true;
+        if (::close(fd) != 0)
+            failed = true;
+        fd = -1;
+        free(buffers[0]);
+        free(buffers[1]);
+        buffers[0] = buffers[1] = nullptr;
+        return !failed;
+    }
 
-            // Evaluate hands using hash tables
-            vector<Card> p1Total = player1Hand;
-            p1Total.insert(p1Total.end(), simCommunity.begin(), simCommunity.end());
-            vector<Card> p2Total = player2Hand;
-            p2Total.insert(p2Total.end(), simCommunity.begin(), simCommunity.end());
+private:
+    void ensure(size_t length) {
+        if (used + length > blockSize)
+            handOff(false);
+    }
 
-            HandValue hv1 = evaluator.evaluateHandHash(p1Total);
-            HandValue hv2 = evaluator.evaluateHandHash(p2Total);
+    // Function to queue the active buffer for writing and switch buffers.
+    // With O_DIRECT only whole alignment units are written; the tail is
+    // carried to the front of the next buffer unless this is the final block.
+    void handOff(bool final) {
+        size_t writeSize = used;
+        size_t carry = 0;
+        if (directIO) {
+            if (final) {
+                writeSize = (used + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT;
+                memset(buffers[active] + used, 0, writeSize - used);
+            }
+            else {
+                writeSize = used / IO_ALIGNMENT * IO_ALIGNMENT;
+                carry = used - writeSize;
+            }
+        }
 
-            // Compare hands
-            if (hv1 > hv2) p1Wins++;
-            else if (hv2 > hv1) p2Wins++;
-            else ties++;
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [&] { return pendingData == nullptr; });
+        int next = 1 - active;
+        memcpy(buffers[next], buffers[active] + writeSize, carry);
+        pendingData = buffers[active];
+        pendingSize = writeSize;
+        bytesWritten += final ? used : writeSize;
+        active = next;
+        used = carry;
+        lock.unlock();
+        cv.notify_all();
+
+        if (final) {
+            lock.lock();
+            cv.wait(lock, [&] { return pendingData == nullptr; });
         }
+    }
 
-        auto endTime = chrono::high_resolution_clock::now();
-        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+    void flushLoop() {
+        while (true) {
+            char* data;
+            size_t size;
+            {
+                unique_lock<mutex> lock(mtx);
+                cv.wait(lock, [&] { return pendingData != nullptr || stopping; });
+                if (pendingData == nullptr)
+                    return;
+                data = pendingData;
+                size = pendingSize;
+            }
+
+            size_t written = 0;
+            while (written < size) {
+                ssize_t n = ::write(fd, data + written, size - written);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    failed = true;
+                    break;
+                }
+                written += static_cast<size_t>(n);
+            }
 
-        p1Win = (p1Wins / static_cast<double>(trials)) * 100.0;
-        p2Win = (p2Wins / static_cast<double>(trials)) * 100.0;
-        tie = (ties / static_cast<double>(trials)) * 100.0;
+            {
+                lock_guard<mutex> lock(mtx);
+                pendingData = nullptr;
+            }
+            cv.notify_all();
+        }
     }
 };
 
-// Function to generate a random card not already used
-Card generateRandomCard(unordered_set<string>& usedCards, mt19937& rng) {
-    while (true) {
-        int suitInt = rng() % 4; // 0 to 3
-        int rankInt = rng() % 13 + 2; // 2 to 14 (ACE)
-        Card card(static_cast<Suit>(suitInt), static_cast<Rank>(rankInt));
-        string cardKey = cardToString(card);
-        if (usedCards.find(cardKey) == usedCards.end()) {
-            usedCards.insert(cardKey);
-            return card;
+// Multi-process mode: forked workers take ranges of SimulationIDs from a shared ring and
+// stream CSV text back; a dead worker's range is re-queued and a replacement forked.
+
+const int MAX_WORKER_PROCESSES = 64;
+const size_t WORK_RING_SLOTS = 1024;
+const size_t RESULT_RING_BYTES = 1 << 20;
+const size_t RESULT_FRAGMENT_BYTES = 64 * 1024; // Text a worker buffers before sending
+
+// Structure to represent a range of SimulationIDs handed to a worker
+struct WorkRange {
+    int32_t firstID;
+    int32_t count;
+};
+
+// Structure to represent the header of a result message: which range the
+// text belongs to and whether it completes the range
+struct FragmentHeader {
+    int32_t firstID;
+    int32_t last;
+};
+
+// Structure to represent a worker's slot: the range it is working on (0 when
+// idle) and the work ring position it last tried to claim
+struct alignas(64) WorkerSlot {
+    atomic<int32_t> currentRange;
+    atomic<uint64_t> claimedPos;
+};
+
+// Structure to represent the memory shared between the coordinator and its workers
+struct CoordinatorShared {
+    SharedMpmcRing<WorkRange, WORK_RING_SLOTS> work;
+    alignas(64) atomic<int> finished;         // Set once every range is written
+    alignas(64) atomic<long long> cacheHits;
+    WorkerSlot slots[MAX_WORKER_PROCESSES];
+    SharedByteRing<RESULT_RING_BYTES> results[MAX_WORKER_PROCESSES];
+};
+
+// Function run by a forked worker: takes ranges until the coordinator is
+// finished. Always leaves through _exit, so nothing inherited from the
+// coordinator (such as the CSV writer's thread) is ever destroyed here.
+[[noreturn]] void runWorkerProcess(CoordinatorShared& shared, int slot, uint64_t seed, int trials,
+    const vector<EvaluatorBackend>& backends, EquityCache& cache, bool profile, bool categories) {
+    // Do not outlive the coordinator
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+    BulkCardDealer dealer(seed);
+    CsvRowFormatter formatter;
+    const EquityCache* cacheForRows = cache.isOpen() ? &cache : nullptr;
+    SharedByteRing<RESULT_RING_BYTES>& results = shared.results[slot];
+    string text;
+    auto send = [&](int32_t firstID, bool last) {
+        FragmentHeader header{ firstID, last ? 1 : 0 };
+        for (int round = 0; !results.tryWrite(header, text.data(), static_cast<uint32_t>(text.size())); ++round)
+            pipelineBackoff(round);
+        text.clear();
+        };
+
+    WorkRange range;
+    for (int round = 0;; ++round) {
+        if (!shared.work.tryPop(range, shared.slots[slot].claimedPos)) {
+            if (shared.finished) _exit(0);
+            pipelineBackoff(round);
+            continue;
         }
+        round = 0;
+        shared.slots[slot].currentRange = range.firstID;
+        for (int simID = range.firstID; simID < range.firstID + range.count; ++simID) {
+            DatasetRow row;
+            row.simID = simID;
+            generateRandomSpot(row, dealer);
+            Simulator probe(row.player1Hand, row.player2Hand, row.gameStage, row.communityCards);
+            if (answerFromCache(row, probe, trials, cacheForRows)) {
+                shared.cacheHits++;
+            }
+            else {
+                for (EvaluatorBackend backend : backends)
+                    runRowChunk(row, backend, trials, profile, categories && backend == backends.front());
+            }
+            poolRowResults(row, trials, backends, cache);
+            formatter.formatRow(row, trials, backends, profile, categories, cacheForRows != nullptr);
+            text += row.text;
+            if (text.size() >= RESULT_FRAGMENT_BYTES) send(range.firstID, false);
+        }
+        send(range.firstID, true);
+        shared.slots[slot].currentRange = 0;
     }
 }
 
-// Function to generate a random hand for a player
-void generateRandomHand(vector<Card>& hand, unordered_set<string>& usedCards, mt19937& rng) {
-    hand.clear();
-    for (int i = 0; i < 2; ++i) {
-        hand.push_back(generateRandomCard(usedCards, rng));
+// Function to produce the dataset rows with worker processes and write them
+// to csvFile; returns false if the workers kept dying and the run was abandoned
+bool runProcessCoordinator(DatasetRowWriter& csvFile, int numSimulations, int trials, const vector<EvaluatorBackend>& backends,
+    EquityCache& cache, bool profile, bool categories, int processes, int rangeRows) {
+    CoordinatorShared* shared = mapShared<CoordinatorShared>();
+    if (!shared) {
+        cerr << "Failed to map shared memory: " << strerror(errno) << endl;
+        return false;
     }
-}
+    shared->work.init();
+
+    const int rangeCount = (numSimulations + rangeRows - 1) / rangeRows;
+    auto rangeAt = [&](int index) {
+        WorkRange range;
+        range.firstID = index * rangeRows + 1;
+        range.count = min(rangeRows, numSimulations - index * rangeRows);
+        return range;
+        };
+    auto rangeIndex = [&](int32_t firstID) { return (firstID - 1) / rangeRows; };
+
+    vector<char> completed(rangeCount, 0);
+    map<int, string> finishedText; // Completed ranges waiting for their turn to be written
+    deque<int> requeued;
+    int nextFresh = 0, nextToWrite = 0, completedCount = 0;
+    long long workersLost = 0, rangesRequeued = 0, restarts = 0;
+    const long long maxRestarts = 4LL * processes + 4;
+
+    // Per worker: process id (-1 when not running) and the partial text of the range it is sending
+    vector<pid_t> pids(processes, -1);
+    vector<string> partial(processes);
+    vector<int32_t> partialRange(processes, 0);
+
+    auto spawn = [&](int slot) {
+        shared->results[slot].init();
+        shared->slots[slot].currentRange = 0;
+        shared->slots[slot].claimedPos = SharedMpmcRing<WorkRange, WORK_RING_SLOTS>::NO_CLAIM;
+        partial[slot].clear();
+        partialRange[slot] = 0;
+        uint64_t seed = BulkCardDealer::randomSeed();
+        cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "fork failed: " << strerror(errno) << endl;
+            return false;
+        }
+        if (pid == 0) runWorkerProcess(*shared, slot, seed, trials, backends, cache, profile, categories);
+        pids[slot] = pid;
+        return true;
+        };
+
+    // Function to take every message a worker has sent; returns true if there were any
+    auto drain = [&](int slot) {
+        FragmentHeader header;
+        string payload;
+        bool any = false;
+        while (shared->results[slot].tryRead(header, payload)) {
+            any = true;
+            if (header.firstID != partialRange[slot]) {
+                partial[slot].clear();
+                partialRange[slot] = header.firstID;
+            }
+            partial[slot] += payload;
+            if (!header.last) continue;
+            int index = rangeIndex(header.firstID);
+            // A range can finish twice if it was re-queued while still running; keep the first
+            if (!completed[index]) {
+                completed[index] = 1;
+                completedCount++;
+                finishedText[index] = move(partial[slot]);
+            }
+            partial[slot].clear();
+            partialRange[slot] = 0;
+        }
+        return any;
+        };
+
+    auto requeue = [&](int index) {
+        if (completed[index]) return;
+        requeued.push_back(index);
+        rangesRequeued++;
+        };
+    auto requeueRange = [&](const WorkRange& range) { requeue(rangeIndex(range.firstID)); };
+
+    // Ring positions announced by dead workers, released once no live worker
+    // has announced the same position
+    vector<uint64_t> pendingClaims;
+    auto announcedByLive = [&](uint64_t pos) {
+        for (int slot = 0; slot < processes; ++slot) {
+            if (pids[slot] > 0 && shared->slots[slot].claimedPos.load() == pos) return true;
+        }
+        return false;
+        };
+
+    auto start = chrono::steady_clock::now();
+    for (int slot = 0; slot < processes; ++slot) {
+        if (!spawn(slot)) {
+            shared->finished = 1;
+            for (pid_t pid : pids) {
+                if (pid > 0) waitpid(pid, nullptr, 0);
+            }
+            unmapShared(shared);
+            return false;
+        }
+    }
+    cout << "Coordinator: " << processes << " worker processes, " << rangeCount << " ranges of up to "
+        << rangeRows << " rows.\n";
+
+    bool abandoned = false;
+    chrono::steady_clock::time_point stalledSince;
+    bool stalled = false;
+    for (int round = 0; nextToWrite < rangeCount; ++round) {
+        bool progress = false;
+
+        // Keep the work ring fed, re-queued ranges first
+        while (!requeued.empty() || nextFresh < rangeCount) {
+            bool fromRequeue = !requeued.empty();
+            int index = fromRequeue ? requeued.front() : nextFresh;
+            if (!shared->work.tryPush(rangeAt(index))) break;
+            if (fromRequeue) requeued.pop_front();
+            else nextFresh++;
+            progress = true;
+        }
 
-// Function to randomly select a game stage
-string selectRandomGameStage(mt19937& rng) {
-    vector<string> stages = { "preflop", "flop", "turn", "river" };
-    return stages[rng() % stages.size()];
-}
+        // Collect results and write completed ranges in order
+        for (int slot = 0; slot < processes; ++slot) {
+            if (pids[slot] > 0 && drain(slot)) progress = true;
+        }
+        while (!finishedText.empty() && finishedText.begin()->first == nextToWrite) {
+            csvFile.appendText(finishedText.begin()->second);
+            finishedText.erase(finishedText.begin());
+            WorkRange range = rangeAt(nextToWrite);
+            cout << "Simulations " << range.firstID << "-" << range.firstID + range.count - 1 << " completed.\n";
+            nextToWrite++;
+            progress = true;
+        }
+
+        // Reap dead workers: keep what they sent, re-queue what they were
+        // working on and fork a replacement
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            int slot = static_cast<int>(find(pids.begin(), pids.end(), pid) - pids.begin());
+            if (slot == processes) continue;
+            progress = true;
+            drain(slot);
+            pids[slot] = -1;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+
+            workersLost++;
+            cout << "Worker " << slot << " (pid " << pid << ") ";
+            if (WIFSIGNALED(status)) cout << "was killed by signal " << WTERMSIG(status);
+            else cout << "exited with status " << WEXITSTATUS(status);
+            int32_t current = shared->slots[slot].currentRange;
+            if (current > 0 && !completed[rangeIndex(current)]) {
+                requeue(rangeIndex(current));
+                cout << "; re-queued simulations " << current << "-" << current + rangeAt(rangeIndex(current)).count - 1;
+            }
+            cout << ".\n";
+            // A range it had claimed but not yet read would otherwise block the ring
+            pendingClaims.push_back(shared->slots[slot].claimedPos.load());
+
+            if (completedCount < rangeCount && restarts < maxRestarts && spawn(slot)) restarts++;
+        }
+        for (size_t i = 0; i < pendingClaims.size();) {
+            if (shared->work.releaseClaim(pendingClaims[i], announcedByLive, requeueRange))
+                pendingClaims.erase(pendingClaims.begin() + i);
+            else
+                ++i;
+        }
+        if (completedCount < rangeCount && count_if(pids.begin(), pids.end(), [](pid_t p) { return p > 0; }) == 0) {
+            cerr << "All worker processes have died; giving up after " << workersLost << " failures." << endl;
+            abandoned = true;
+            break;
+        }
 
-// Function to generate community cards based on game stage
-void generateCommunityCards(const string& stage, vector<Card>& communityCards, unordered_set<string>& usedCards, mt19937& rng) {
-    communityCards.clear();
-    int numCommunity = 0;
-    if (stage == "flop") numCommunity = 3;
-    else if (stage == "turn") numCommunity = 4;
-    else if (stage == "river") numCommunity = 5;
+        // A range taken by a worker that died before recording it in its slot
+        // is in neither place. If nothing is queued and no worker is busy for a
+        // while but ranges are missing, put the missing ones back.
+        if (!progress) {
+            bool idle = nextFresh == rangeCount && requeued.empty() && shared->work.size() == 0 && completedCount < rangeCount;
+            for (int slot = 0; idle && slot < processes; ++slot) {
+                if (pids[slot] > 0 && shared->slots[slot].currentRange != 0) idle = false;
+            }
+            if (idle && !stalled) {
+                stalled = true;
+                stalledSince = chrono::steady_clock::now();
+            }
+            else if (idle && chrono::steady_clock::now() - stalledSince > chrono::milliseconds(200)) {
+                for (int index = 0; index < rangeCount; ++index) requeue(index);
+                stalled = false;
+            }
+            else if (!idle) {
+                stalled = false;
+            }
+            pipelineBackoff(round);
+        }
+        else {
+            round = 0;
+            stalled = false;
+        }
+    }
 
-    for (int i = 0; i < numCommunity; ++i) {
-        communityCards.push_back(generateRandomCard(usedCards, rng));
+    // Let the workers drain out and exit
+    shared->finished = 1;
+    if (abandoned) {
+        for (pid_t pid : pids) {
+            if (pid > 0) kill(pid, SIGKILL);
+        }
+    }
+    for (pid_t pid : pids) {
+        if (pid > 0) waitpid(pid, nullptr, 0);
     }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!abandoned) {
+        cout << fixed << setprecision(2) << "Coordinator finished " << numSimulations << " rows in " << seconds << " s ("
+            << numSimulations / max(seconds, 1e-9) << " rows/s); " << workersLost << " worker(s) lost, "
+            << rangesRequeued << " range(s) re-queued.\n" << defaultfloat;
+        if (cache.isOpen())
+            cout << "Equity cache answered " << shared->cacheHits.load() << " of " << numSimulations << " rows.\n";
+    }
+    unmapShared(shared);
+    return !abandoned;
 }
 
 // Main function
-int main() {
+int main(int argc, char* argv[]) {
     cout << "=== Automated Poker Odds Simulator ===\n\n";
 
     // Number of simulations to generate
     int numSimulations = 100000; // Adjust as needed
     int trialsPerSimulation = 100; // Number of Monte Carlo trials per simulation
+    string outputPath = "../PokerOddsDataset.csv";
+    bool directIO = false;
+    bool coverage = false;
+    bool coverageWeighted = false;
+    int numThreads = static_cast<int>(thread::hardware_concurrency());
+    bool pinThreads = false;
+    string cachePath;
+    bool profile = false;
+    bool categories = false;
+    int generateThreads = 1;
+    int formatThreads = 1;
+    int queueDepth = 4096;
+    // Evaluators to run every row with; list several to compare them
+    vector<EvaluatorBackend> backends = { EVAL_SEVEN };
+    // Worker processes (0 runs the threaded pipeline in this process) and rows per range
+    int processes = 0;
+    int rangeRows = 256;
+
+    // Command line options
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--rows" && i + 1 < argc) numSimulations = atoi(argv[++i]);
+        else if (arg == "--trials" && i + 1 < argc) trialsPerSimulation = atoi(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--direct-io") directIO = true;
+        else if (arg == "--coverage") coverage = true;
+        else if (arg == "--coverage-weighted") coverage = coverageWeighted = true;
+        else if (arg == "--threads" && i + 1 < argc) numThreads = atoi(argv[++i]);
+        else if (arg == "--pin-threads") pinThreads = true;
+        else if (arg == "--cache" && i + 1 < argc) cachePath = argv[++i];
+        else if (arg == "--profile") profile = true;
+        else if (arg == "--categories") categories = true;
+        else if (arg == "--generate-threads" && i + 1 < argc) generateThreads = atoi(argv[++i]);
+        else if (arg == "--format-threads" && i + 1 < argc) formatThreads = atoi(argv[++i]);
+        else if (arg == "--queue-depth" && i + 1 < argc) queueDepth = atoi(argv[++i]);
+        else if (arg == "--processes" && i + 1 < argc) processes = atoi(argv[++i]);
+        else if (arg == "--range-rows" && i + 1 < argc) rangeRows = atoi(argv[++i]);
+        else if (arg == "--backends" && i + 1 < argc) {
+            string error;
+            if (!parseEvaluatorBackendList(argv[++i], backends, error)) {
+                cerr << "Invalid --backends: " << error << endl;
+                return 1;
+            }
+        }
+        else {
+            cerr << "Usage: " << argv[0] << " [--rows N] [--trials N] [--output path] [--direct-io]"
+                << " [--coverage | --coverage-weighted] [--threads N] [--pin-threads]"
+                << " [--cache path] [--profile] [--categories] [--generate-threads N] [--format-threads N]"
+                << " [--queue-depth N] [--backends map,hash,seven] [--processes N] [--range-rows N]" << endl;
+            return 1;
+        }
+    }
+
+    if (numThreads <= 0) numThreads = 1;
+    if (formatThreads <= 0) formatThreads = 1;
+    if (queueDepth <= 0) queueDepth = 4096;
+    // The coverage generator walks its classes in order, so it runs on one thread
+    if (generateThreads <= 0 || coverage) generateThreads = 1;
+    if (rangeRows <= 0) rangeRows = 256;
+    if (processes < 0 || processes > MAX_WORKER_PROCESSES) {
+        cerr << "--processes must be between 0 (threads only) and " << MAX_WORKER_PROCESSES << "." << endl;
+        return 1;
+    }
+    if (processes > 0 && coverage) {
+        // Coverage classes are walked in one sequence, which cannot be split across processes
+        cerr << "--processes only supports random spots, not --coverage." << endl;
+        return 1;
+    }
+
+    // Open the persistent equity cache
+    EquityCache cache;
+    if (!cachePath.empty()) {
+        string error;
+        if (!cache.open(cachePath, EquityCache::DEFAULT_SLOTS, error)) {
+            cerr << "Failed to open equity cache: " << error << endl;
+            return 1;
+        }
+    }
+    const EquityCache* cacheForRows = cache.isOpen() ? &cache : nullptr;
 
     // Open CSV file for writing
-    ofstream csvFile("../PokerOddsDataset.csv");
-    if (!csvFile.is_open()) {
+    DatasetRowWriter csvFile;
+    if (!csvFile.open(outputPath, directIO)) {
         cerr << "Failed to open CSV file for writing." << endl;
         return 1;
     }
 
-    // Write CSV headers
-    csvFile << "SimulationID,Player1Hand,Player2Hand,GameStage,CommunityCards,"
-        << "P1Win_Map,P2Win_Map,Tie_Map,Time_Map,"
-        << "P1Win_Hash,P2Win_Hash,Tie_Hash,Time_Hash\n";
+    // Write CSV headers; profiling adds per-trial hardware counts after each backend's time
+    csvFile.appendText("SimulationID,Player1Hand,Player2Hand,GameStage,CommunityCards");
+    for (EvaluatorBackend backend : backends) {
+        const char* backendName = EVALUATOR_BACKEND_LABELS[backend];
+        for (const char* column : { "P1Win", "P2Win", "Tie", "Time" }) {
+            csvFile.appendChar(',');
+            csvFile.appendText(string(column) + "_" + backendName);
+        }
+        if (!profile) continue;
+        for (const char* eventName : PERF_EVENT_NAMES) {
+            csvFile.appendChar(',');
+            csvFile.appendText(string(eventName) + "_" + backendName);
+        }
+    }
+    // Cached rows may rest on more trials than requested, so PokerProj_Merge
+    // needs the count to pool them
+    if (cacheForRows) csvFile.appendText(",Trials");
+    // Category columns: P1_HighCard ... P2_StraightFlush, percent of trials
+    if (categories) {
+        for (const char* player : { "P1_", "P2_" }) {
+            for (int c = 1; c <= HAND_CATEGORY_COUNT; ++c) {
+                csvFile.appendChar(',');
+                csvFile.appendText(string(player) + HAND_CATEGORY_LABELS[c]);
+            }
+        }
+    }
+    csvFile.appendChar('\n');
+
+    if (processes > 0) {
+        bool completed = runProcessCoordinator(csvFile, numSimulations, trialsPerSimulation, backends, cache, profile, categories, processes, rangeRows);
+        if (!csvFile.close() || !completed) {
+            cerr << "Failed to write CSV file." << endl;
+            return 1;
+        }
+        cout << "\nAll simulations completed. Results saved to '" << outputPath << "'.\n";
+        return 0;
+    }
 
-    // Random number generator
+    // Pipeline: generate -> simulate -> format -> write. A generator waits before taking a row
+    // more than queueDepth past the next one to write, which bounds the queues and the reorder map.
+    CpuTopology topology = detectCpuTopology();
+    WorkStealingScheduler scheduler(numThreads, pinThreads ? &topology : nullptr);
+    cout << "Pipeline: " << generateThreads << " generate, " << numThreads << " simulate";
+    if (pinThreads)
+        cout << " (pinned across " << topology.numNodes() << " NUMA node(s))";
+    cout << ", " << formatThreads << " format and 1 write thread(s).\n";
+
+    BoundedQueue<DatasetRow*> genQueue(queueDepth, generateThreads);
+    BoundedQueue<DatasetRow*> formatQueue(queueDepth, 1);
+    BoundedQueue<DatasetRow*> writeQueue(queueDepth, formatThreads);
+    atomic<int> nextToWrite{ 1 };
+    const int maxAhead = static_cast<int>(formatQueue.capacity());
+
+    StageMetrics generateStage("generate", generateThreads);
+    StageMetrics simulateStage("simulate", numThreads);
+    StageMetrics formatStage("format", formatThreads);
+    StageMetrics writeStage("write", 1);
+    auto nanosSince = [](chrono::steady_clock::time_point start) {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        };
+    auto pipelineStart = chrono::steady_clock::now();
+
+    // Generate stage
+    atomic<int> nextSimID{ 1 };
     random_device rd;
-    mt19937 rng(rd());
-
-    for (int simID = 1; simID <= numSimulations; ++simID) {
-        vector<Card> player1Hand;
-        vector<Card> player2Hand;
-        vector<Card> communityCards;
-        unordered_set<string> usedCards;
-
-        // Generate random hands for players
-        generateRandomHand(player1Hand, usedCards, rng);
-        generateRandomHand(player2Hand, usedCards, rng);
-
-        // Randomly select game stage
-        string gameStage = selectRandomGameStage(rng);
-
-        // Generate community cards based on game stage
-        generateCommunityCards(gameStage, communityCards, usedCards, rng);
-
-        // Initialize Simulator
-        Simulator simulator(player1Hand, player2Hand, gameStage, communityCards);
-
-        // Run map-based simulation
-        double p1WinMap = 0.0, p2WinMap = 0.0, tieMap = 0.0;
-        long long execTimeMap = 0;
-        simulator.runSimulationMap(trialsPerSimulation, p1WinMap, p2WinMap, tieMap, execTimeMap);
-
-        // Run hash table-based simulation
-        double p1WinHash = 0.0, p2WinHash = 0.0, tieHash = 0.0;
-        long long execTimeHash = 0;
-        simulator.runSimulationHash(trialsPerSimulation, p1WinHash, p2WinHash, tieHash, execTimeHash);
-
-        // Prepare data for CSV
-        stringstream ss;
-        ss << simID << ",";
-        // Player 1 Hand
-        ss << "\"";
-        for (const auto& card : player1Hand) ss << cardToString(card) << " ";
-        ss << "\",";
-        // Player 2 Hand
-        ss << "\"";
-        for (const auto& card : player2Hand) ss << cardToString(card) << " ";
-        ss << "\",";
-        // Game Stage
-        ss << gameStage << ",";
-        // Community Cards
-        ss << "\"";
-        for (const auto& card : communityCards) ss << cardToString(card) << " ";
-        ss << "\",";
-        // Map-Based Results
-        ss << p1WinMap << "," << p2WinMap << "," << tieMap << "," << execTimeMap << ",";
-        // Hash Table-Based Results
-        ss << p1WinHash << "," << p2WinHash << "," << tieHash << "," << execTimeHash << "\n";
-
-        // Write to CSV
-        csvFile << ss.str();
-
-        // Optional: Print progress to console
-        cout << "Simulation " << simID << " completed.\n";
-    }
-
-    csvFile.close();
-    cout << "\nAll simulations completed. Results saved to 'PokerOddsDataset.csv'.\n";
+    mt19937 coverageRng(rd());
+    CoverageSpotGenerator coverageGenerator(coverageWeighted, coverageRng);
+    vector<thread> generators;
+    for (int g = 0; g < generateThreads; ++g) {
+        uint64_t seed = BulkCardDealer::randomSeed();
+        generators.emplace_back([&, seed] {
+            BulkCardDealer dealer(seed);
+            while (true) {
+                int simID = nextSimID++;
+                if (simID > numSimulations) break;
+                auto wait = chrono::steady_clock::now();
+                for (int round = 0; simID >= nextToWrite + maxAhead; ++round) pipelineBackoff(round);
+                generateStage.outputWaitNanos += nanosSince(wait);
+                auto start = chrono::steady_clock::now();
+                auto row = new DatasetRow();
+                row->simID = simID;
+
+                if (coverage)
+                    coverageGenerator.next(row->player1Hand, row->player2Hand, row->gameStage, row->communityCards);
+                else
+                    generateRandomSpot(*row, dealer);
+                generateStage.busyNanos += nanosSince(start);
+                generateStage.items++;
+                generateStage.outputWaitNanos += genQueue.push(row);
+            }
+            genQueue.producerDone();
+            });
+    }
+
+    // Simulate stage: rows go to the scheduler; the last chunk of each row
+    // passes it on. Chunk time is counted as the stage's busy time.
+    // Rows waiting in or running on the scheduler count as the stage's queue.
+    atomic<int> simulating{ 0 };
+    function<void(DatasetRow&)> onSimulated = [&](DatasetRow& row) {
+        simulating--;
+        for (EvaluatorBackend backend : backends)
+            simulateStage.busyNanos += row.totals[backend].execMicros * 1000;
+        simulateStage.items++;
+        formatQueue.push(&row);
+        };
+    thread dispatcher([&] {
+        DatasetRow* row;
+        long long waited;
+        while (genQueue.pop(row, waited)) {
+            simulateStage.inputWaitNanos += waited;
+            simulating++;
+            scheduler.submit([row, trialsPerSimulation, &backends, &scheduler, cacheForRows, profile, categories, &onSimulated] {
+                simulateRow(*row, trialsPerSimulation, backends, scheduler, cacheForRows, profile, categories, onSimulated);
+                });
+        }
+        scheduler.waitIdle();
+        formatQueue.producerDone();
+        });
+
+    // Format stage
+    CsvRowFormatter formatter;
+    vector<thread> formatters;
+    for (int f = 0; f < formatThreads; ++f) {
+        formatters.emplace_back([&] {
+            DatasetRow* row;
+            long long waited;
+            while (formatQueue.pop(row, waited)) {
+                formatStage.inputWaitNanos += waited;
+                auto start = chrono::steady_clock::now();
+
+                poolRowResults(*row, trialsPerSimulation, backends, cache);
+                formatter.formatRow(*row, trialsPerSimulation, backends, profile, categories, cacheForRows != nullptr);
+
+                formatStage.busyNanos += nanosSince(start);
+                formatStage.items++;
+                formatStage.outputWaitNanos += writeQueue.push(row);
+            }
+            writeQueue.producerDone();
+            });
+    }
+
+    // Queue depths are sampled every millisecond while the pipeline runs
+    atomic<bool> pipelineDone{ false };
+    thread depthSampler([&] {
+        while (!pipelineDone) {
+            simulateStage.sampleDepth(static_cast<long long>(genQueue.size()) + simulating);
+            formatStage.sampleDepth(static_cast<long long>(formatQueue.size()));
+            writeStage.sampleDepth(static_cast<long long>(writeQueue.size()));
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        });
+
+    // Write stage (this thread): rows arrive out of order and are written
+    // in SimulationID order
+    PerfSample runPerf[EVAL_BACKEND_COUNT];
+    long long runPerfTrials[EVAL_BACKEND_COUNT] = {};
+    int runPerfUnavailable[EVAL_BACKEND_COUNT] = {};
+    long long cacheHits = 0;
+    map<int, unique_ptr<DatasetRow>> reorder;
+    DatasetRow* arrived;
+    long long waited;
+    while (writeQueue.pop(arrived, waited)) {
+        writeStage.inputWaitNanos += waited;
+        auto start = chrono::steady_clock::now();
+        reorder[arrived->simID].reset(arrived);
+        while (!reorder.empty() && reorder.begin()->first == nextToWrite) {
+            unique_ptr<DatasetRow> row = move(reorder.begin()->second);
+            reorder.erase(reorder.begin());
+            csvFile.appendText(row->text);
+
+            if (row->fromCache) cacheHits++;
+            if (profile) {
+                for (EvaluatorBackend backend : backends) {
+                    const BackendTotals& totals = row->totals[backend];
+                    for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+                        if (!row->fromCache && !(totals.perfUnavailable & (1 << e)))
+                            runPerf[backend].counts[e] += totals.perfCounts[e];
+                    }
+                    runPerfTrials[backend] += row->fromCache ? 0 : trialsPerSimulation;
+                    runPerfUnavailable[backend] |= totals.perfUnavailable;
+                }
+            }
+
+            // Optional: Print progress to console
+            cout << "Simulation " << row->simID << " completed.\n";
+            nextToWrite++;
+            writeStage.items++;
+        }
+        writeStage.busyNanos += nanosSince(start);
+    }
+
+    for (auto& generator : generators) generator.join();
+    dispatcher.join();
+    for (auto& f : formatters) f.join();
+    pipelineDone = true;
+    depthSampler.join();
+    double wallSeconds = nanosSince(pipelineStart) / 1e9;
+
+    if (cache.isOpen())
+        cout << "Equity cache answered " << cacheHits << " of " << numSimulations << " rows.\n";
+
+    // Per-stage metrics: busy, starved (input empty) and blocked (output
+    // full) are shares of the stage's thread time over the whole run
+    cout << "\n--- Pipeline Metrics (" << fixed << setprecision(2) << wallSeconds << " s) ---\n";
+    cout << left << setw(10) << "Stage" << right << setw(8) << "Threads" << setw(10) << "Rows" << setw(12) << "Rows/s"
+        << setw(8) << "Busy%" << setw(10) << "Starved%" << setw(10) << "Blocked%" << setw(11) << "AvgQueue" << setw(10) << "MaxQueue" << "\n";
+    for (StageMetrics* stage : { &generateStage, &simulateStage, &formatStage, &writeStage }) {
+        double threadNanos = max(1.0, wallSeconds * 1e9 * stage->threads);
+        cout << left << setw(10) << stage->name << right << setw(8) << stage->threads << setw(10) << stage->items.load()
+            << setw(12) << stage->items / max(wallSeconds, 1e-9)
+            << setw(8) << 100.0 * stage->busyNanos / threadNanos
+            << setw(10) << 100.0 * stage->inputWaitNanos / threadNanos
+            << setw(10) << 100.0 * stage->outputWaitNanos / threadNanos;
+        if (stage->depthSamples > 0)
+            cout << setw(11) << static_cast<double>(stage->depthSum) / stage->depthSamples << setw(10) << stage->depthMax.load();
+        else
+            cout << setw(11) << "-" << setw(10) << "-";
+        cout << "\n";
+    }
+    cout << defaultfloat;
+
+    if (!csvFile.close()) {
+        cerr << "Failed to write CSV file." << endl;
+        return 1;
+    }
+    cout << "\nAll simulations completed. Results saved to '" << outputPath << "'.\n";
+
+    if (profile) {
+        for (EvaluatorBackend backend : backends) {
+            for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+                runPerf[backend].available[e] = !(runPerfUnavailable[backend] & (1 << e));
+            cout << "\n" << EVALUATOR_BACKEND_LABELS[backend] << " Profile (" << runPerfTrials[backend] << " trials):\n";
+            printPerfProfile(runPerf[backend], runPerfTrials[backend]);
+        }
+    }
 
     return 0;
 }
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdint>
+
+#include "PokerSimulator.h"
+
+using namespace std;
+
+// Functions to read datasets written by PokerProj_Automated and PokerProj_Merge;
+// columns are located by header name.
+
+// Structure to represent where each needed column sits in a dataset file
+struct DatasetLayout {
+    string path;
+    int player1 = -1, player2 = -1, stage = -1, board = -1;
+    int results[EVAL_BACKEND_COUNT][4]; // P1Win, P2Win, Tie, Time per backend; -1 when absent
+    int backendMask = 0;                // Bit b set when backend b has all four columns
+    int trialsColumn = -1;              // Optional; written by PokerProj_Merge
+    int lastColumn = -1;                // Highest column index used
+    long long defaultTrials = 100;      // Trials per row when there is no Trials column
+};
+
+// Structure to represent one parsed dataset row
+struct DatasetEntry {
+    uint64_t player1 = 0, player2 = 0, board = 0; // Card masks
+    int boardCount = 0;
+    long long trials = 0;
+    double percent[EVAL_BACKEND_COUNT][3] = {}; // P1 win, P2 win and tie per backend present
+    long long timeMs[EVAL_BACKEND_COUNT] = {};
+};
+
+// Game stage names by number of community cards
+inline const char* const DATASET_STAGE_NAMES[6] = { "preflop", nullptr, nullptr, "flop", "turn", "river" };
+
+// Function to split a CSV line into fields, honouring double quotes
+inline void splitCsvLine(string_view line, vector<string_view>& fields) {
+    fields.clear();
+    size_t start = 0;
+    bool quoted = false;
+    for (size_t i = 0; i <= line.size(); ++i) {
+        if (i < line.size() && line[i] == '"') quoted = !quoted;
+        else if (i == line.size() || (line[i] == ',' && !quoted)) {
+            string_view field = line.substr(start, i - start);
+            if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+                field = field.substr(1, field.size() - 2);
+            fields.push_back(field);
+            start = i + 1;
+        }
+    }
+}
+
+// Function to parse a number field
+template<typename T>
+inline bool parseCsvNumber(string_view field, T& value) {
+    while (!field.empty() && field.front() == ' ') field.remove_prefix(1);
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\r')) field.remove_suffix(1);
+    auto result = from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == errc() && result.ptr == field.data() + field.size();
+}
+
+// Function to read the header line of a dataset and locate its columns
+inline bool parseDatasetHeader(string_view header, DatasetLayout& layout, string& error) {
+    vector<string_view> names;
+    if (!header.empty() && header.back() == '\r') header.remove_suffix(1);
+    splitCsvLine(header, names);
+    auto find = [&](string_view name) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == name) return static_cast<int>(i);
+        }
+        return -1;
+        };
+
+    layout.player1 = find("Player1Hand");
+    layout.player2 = find("Player2Hand");
+    layout.stage = find("GameStage");
+    layout.board = find("CommunityCards");
+    layout.trialsColumn = find("Trials");
+    const char* columns[4] = { "P1Win_", "P2Win_", "Tie_", "Time_" };
+    layout.backendMask = 0;
+    for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+        bool complete = true;
+        for (int c = 0; c < 4; ++c) {
+            layout.results[b][c] = find(string(columns[c]) + EVALUATOR_BACKEND_LABELS[b]);
+            complete = complete && layout.results[b][c] >= 0;
+        }
+        if (complete) layout.backendMask |= 1 << b;
+        else fill(layout.results[b], layout.results[b] + 4, -1);
+    }
+    if (layout.backendMask == 0) {
+        error = "no complete set of backend result columns";
+        return false;
+    }
+    if (layout.player1 < 0 || layout.player2 < 0 || layout.board < 0) {
+        error = "missing a card column";
+        return false;
+    }
+    layout.lastColumn = max({ layout.player1, layout.player2, layout.stage, layout.board, layout.trialsColumn });
+    for (const auto& backend : layout.results) {
+        for (int column : backend) layout.lastColumn = max(layout.lastColumn, column);
+    }
+    return true;
+}
+
+// Function to parse one data line; returns an error description, or nullptr
+// on success. fields is scratch space reused between calls.
+inline const char* parseDatasetRow(string_view line, const DatasetLayout& layout, vector<string_view>& fields, DatasetEntry& entry) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    splitCsvLine(line, fields);
+    if (static_cast<int>(fields.size()) <= layout.lastColumn)
+        return "too few fields";
+
+    uint8_t indices[5];
+    CardParseResult p1, p2, board;
+    if (!parseCardList(fields[layout.player1], indices, 2, 0, p1) || p1.count != 2)
+        return "bad Player1Hand";
+    if (!parseCardList(fields[layout.player2], indices, 2, p1.mask, p2) || p2.count != 2)
+        return "bad Player2Hand";
+    if (!parseCardList(fields[layout.board], indices, 5, p1.mask | p2.mask, board) || board.count == 1 || board.count == 2)
+        return "bad CommunityCards";
+    if (layout.stage >= 0 && fields[layout.stage] != DATASET_STAGE_NAMES[board.count])
+        return "GameStage does not match CommunityCards";
+    entry.player1 = p1.mask;
+    entry.player2 = p2.mask;
+    entry.board = board.mask;
+    entry.boardCount = board.count;
+
+    entry.trials = layout.defaultTrials;
+    if (layout.trialsColumn >= 0 && (!parseCsvNumber(fields[layout.trialsColumn], entry.trials) || entry.trials <= 0))
+        return "bad Trials";
+
+    for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+        if (!(layout.backendMask & (1 << b))) {
+            fill(entry.percent[b], entry.percent[b] + 3, 0.0);
+            entry.timeMs[b] = 0;
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            if (!parseCsvNumber(fields[layout.results[b][c]], entry.percent[b][c]) ||
+                entry.percent[b][c] < 0.0 || entry.percent[b][c] > 100.0)
+                return "bad percentage";
+        }
+        if (!parseCsvNumber(fields[layout.results[b][3]], entry.timeMs[b]))
+            return "bad time";
+    }
+    return nullptr;
+}
+
+// DatasetBlockReader class to read a dataset in blocks of whole lines, for
+// files too large to load at once
+class DatasetBlockReader {
+private:
+    FILE* file = nullptr;
+    string carry; // Partial last line of the previous block
+    size_t blockBytes = 1 << 20;
+    bool atEnd = false;
+
+    // Function to append up to blockBytes more bytes to text; false at end of file
+    bool fill(string& text) {
+        size_t used = text.size();
+        text.resize(max(blockBytes, used + 4096));
+        size_t got = fread(&text[used], 1, text.size() - used, file);
+        text.resize(used + got);
+        return got > 0;
+    }
+
+public:
+    ~DatasetBlockReader() {
+        if (file) fclose(file);
+    }
+
+    // Function to open a file and read its header line (without the newline)
+    bool open(const string& path, size_t blockSize, string& header, string& error) {
+        file = fopen(path.c_str(), "rb");
+        if (!file) {
+            error = "cannot open " + path;
+            return false;
+        }
+        blockBytes = max<size_t>(blockSize, 4096);
+        size_t newline;
+        while ((newline = carry.find('\n')) == string::npos) {
+            if (!fill(carry)) break;
+        }
+        header.assign(carry, 0, newline);
+        if (!header.empty() && header.back() == '\r') header.pop_back();
+        carry.erase(0, newline == string::npos ? carry.size() : newline + 1);
+        return true;
+    }
+
+    // Function to get the next block of whole lines; false once the file is exhausted
+    bool next(string& block) {
+        block = move(carry);
+        carry.clear();
+        while (!atEnd) {
+            atEnd = !fill(block);
+            if (atEnd) break;
+            // Keep any partial last line for the next block
+            size_t lastNewline = block.rfind('\n');
+            if (lastNewline != string::npos) {
+                carry.assign(block, lastNewline + 1, string::npos);
+                block.resize(lastNewline + 1);
+                break;
+            }
+        }
+        return !block.empty();
+    }
+};
+
+// Function to load a whole dataset into memory; malformed rows are counted
+// in badRows and skipped. Returns false if the file cannot be read.
+inline bool loadDataset(const string& path, DatasetLayout& layout, vector<DatasetEntry>& entries, long long& badRows, string& error) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    string text;
+    char buffer[1 << 16];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) text.append(buffer, got);
+    fclose(file);
+
+    layout.path = path;
+    string_view rest = text;
+    size_t newline = rest.find('\n');
+    if (!parseDatasetHeader(rest.substr(0, newline), layout, error))
+        return false;
+    rest.remove_prefix(newline == string_view::npos ? rest.size() : newline + 1);
+
+    entries.clear();
+    badRows = 0;
+    vector<string_view> fields;
+    while (!rest.empty()) {
+        size_t end = rest.find('\n');
+        string_view line = rest.substr(0, end);
+        rest.remove_prefix(end == string_view::npos ? rest.size() : end + 1);
+        if (line.empty() || line == "\r") continue;
+        DatasetEntry entry;
+        if (parseDatasetRow(line, layout, fields, entry)) badRows++;
+        else entries.push_back(entry);
+    }
+    return true;
+}
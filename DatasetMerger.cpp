@@ -0,0 +1,497 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "PokerSimulator.h"
+#include "DatasetCsv.h"
+#include "Pipeline.h"
+
+using namespace std;
+
+// Tool to merge datasets into one row per canonical spot: rows are sorted with an
+// external merge sort and duplicates are pooled by adding their counts.
+
+// Number of runs merged at once; more runs are reduced in intermediate passes
+const size_t MAX_MERGE_FAN_IN = 64;
+
+// Structure to represent one spot's pooled results, as stored in run files
+struct MergeRecord {
+    SpotKey key;
+    long long trials;                        // Trials per backend
+    long long counts[EVAL_BACKEND_COUNT][3]; // P1 wins, P2 wins and ties per backend
+    long long timeMs[EVAL_BACKEND_COUNT];    // Execution time of each backend
+
+    // Function to pool another record for the same spot into this one
+    void add(const MergeRecord& other) {
+        trials += other.trials;
+        for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+            for (int c = 0; c < 3; ++c) counts[b][c] += other.counts[b][c];
+            timeMs[b] += other.timeMs[b];
+        }
+    }
+};
+
+// Structure to represent a block of whole input lines
+struct TextBlock {
+    const DatasetLayout* layout;
+    string text;
+};
+
+// Function to turn one data line into a canonical record; returns an error
+// description, or nullptr on success
+const char* parseRow(string_view line, const DatasetLayout& layout, vector<string_view>& fields, MergeRecord& record) {
+    DatasetEntry entry;
+    if (const char* error = parseDatasetRow(line, layout, fields, entry))
+        return error;
+    record.trials = entry.trials;
+    for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+        // Merged files write percentages exactly, so rounding recovers the
+        // count; the generator's 6 significant digits recover it exactly up to
+        // a million trials and to within a part per million beyond
+        for (int c = 0; c < 3; ++c) record.counts[b][c] = llround(entry.percent[b][c] * entry.trials / 100.0);
+        record.timeMs[b] = entry.timeMs[b];
+    }
+    record.key = canonicalSpot(entry.board, entry.player1, entry.player2);
+    return nullptr;
+}
+
+// Function to sort records by spot and pool neighbours with the same spot
+void sortAndCombine(vector<MergeRecord>& records) {
+    sort(records.begin(), records.end(), [](const MergeRecord& a, const MergeRecord& b) {
+        return a.key < b.key;
+        });
+    size_t out = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (out > 0 && records[out - 1].key == records[i].key) records[out - 1].add(records[i]);
+        else records[out++] = records[i];
+    }
+    records.resize(out);
+}
+
+// RunReader class to stream the records of a sorted run file
+class RunReader {
+private:
+    FILE* file = nullptr;
+    vector<MergeRecord> buffer;
+    size_t position = 0;
+    size_t filled = 0;
+
+public:
+    RunReader(const string& path, size_t bufferRecords) : buffer(max<size_t>(bufferRecords, 1)) {
+        file = fopen(path.c_str(), "rb");
+    }
+
+    ~RunReader() {
+        if (file) fclose(file);
+    }
+
+    RunReader(const RunReader&) = delete;
+    RunReader& operator=(const RunReader&) = delete;
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // Function to get the next record; false at the end of the run
+    bool next(MergeRecord& record) {
+        if (position == filled) {
+            if (!file) return false;
+            filled = fread(buffer.data(), sizeof(MergeRecord), buffer.size(), file);
+            position = 0;
+            if (filled == 0) return false;
+        }
+        record = buffer[position++];
+        return true;
+    }
+};
+
+// Function to merge sorted runs, pooling equal spots, and pass each result
+// to emit in key order; returns false if a run could not be opened
+template<typename Emit>
+bool mergeRuns(const vector<string>& runs, size_t bufferRecords, Emit emit) {
+    vector<unique_ptr<RunReader>> readers;
+    vector<pair<MergeRecord, size_t>> heap; // Head record of each run, smallest key on top
+    auto greater = [](const pair<MergeRecord, size_t>& a, const pair<MergeRecord, size_t>& b) {
+        return b.first.key < a.first.key;
+        };
+    for (size_t r = 0; r < runs.size(); ++r) {
+        readers.emplace_back(new RunReader(runs[r], bufferRecords));
+        if (!readers.back()->isOpen())
+            return false;
+        MergeRecord head;
+        if (readers.back()->next(head)) heap.push_back({ head, r });
+    }
+    make_heap(heap.begin(), heap.end(), greater);
+
+    bool pending = false;
+    MergeRecord current;
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), greater);
+        auto& top = heap.back();
+        if (pending && current.key == top.first.key) current.add(top.first);
+        else {
+            if (pending) emit(current);
+            current = top.first;
+            pending = true;
+        }
+        if (readers[top.second]->next(top.first)) push_heap(heap.begin(), heap.end(), greater);
+        else heap.pop_back();
+    }
+    if (pending) emit(current);
+    return true;
+}
+
+// Function to write records to a new run file
+bool writeRun(const string& path, const vector<MergeRecord>& records) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(records.data(), sizeof(MergeRecord), records.size(), file) == records.size();
+    return fclose(file) == 0 && ok;
+}
+
+// MergedCsvWriter class to write pooled records in the generator's format
+// for the given backends, plus a Trials column so merged files can be
+// merged again
+class MergedCsvWriter {
+private:
+    FILE* file = nullptr;
+    string out;
+    char cardText[52][4];
+    uint8_t cardTextLength[52];
+    long long nextID = 1;
+    bool failed = false;
+    int backendMask = 0;
+
+    static void appendInt(string& text, long long value) {
+        char buffer[32];
+        text.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+    }
+
+    // Shortest text that reads back as the same double, so counts survive
+    // any number of merge rounds
+    static void appendDouble(string& text, double value) {
+        char buffer[64];
+        text.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+    }
+
+    void appendCards(uint64_t mask) {
+        out += '"';
+        for (; mask; mask &= mask - 1) {
+            int index = __builtin_ctzll(mask);
+            out.append(cardText[index], cardTextLength[index]);
+        }
+        out += '"';
+    }
+
+    void flush() {
+        if (!out.empty() && fwrite(out.data(), 1, out.size(), file) != out.size()) failed = true;
+        out.clear();
+    }
+
+public:
+    MergedCsvWriter() {
+        for (int i = 0; i < 52; ++i) {
+            string text = cardToString(cardFromIndex(i)) + " ";
+            memcpy(cardText[i], text.data(), text.size());
+            cardTextLength[i] = static_cast<uint8_t>(text.size());
+        }
+    }
+
+    ~MergedCsvWriter() {
+        close();
+    }
+
+    bool open(const string& path, int backends) {
+        file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        backendMask = backends;
+        out = "SimulationID,Player1Hand,Player2Hand,GameStage,CommunityCards";
+        for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+            if (!(backendMask & (1 << b))) continue;
+            for (const char* column : { "P1Win_", "P2Win_", "Tie_", "Time_" }) {
+                out += ',';
+                out += column;
+                out += EVALUATOR_BACKEND_LABELS[b];
+            }
+        }
+        out += ",Trials\n";
+        return true;
+    }
+
+    // Function to append one merged spot as a row
+    void write(const MergeRecord& record) {
+        static const char* stageNames[6] = { "preflop", "", "", "flop", "turn", "river" };
+        appendInt(out, nextID++);
+        out += ',';
+        appendCards(record.key.p1);
+        out += ',';
+        appendCards(record.key.p2);
+        out += ',';
+        out += stageNames[__builtin_popcountll(record.key.board)];
+        out += ',';
+        appendCards(record.key.board);
+        double trials = static_cast<double>(record.trials);
+        for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+            if (!(backendMask & (1 << b))) continue;
+            for (int c = 0; c < 3; ++c) {
+                out += ',';
+                appendDouble(out, (record.counts[b][c] / trials) * 100.0);
+            }
+            out += ',';
+            appendInt(out, record.timeMs[b]);
+        }
+        out += ',';
+        appendInt(out, record.trials);
+        out += '\n';
+        if (out.size() >= (1 << 20)) flush();
+    }
+
+    // Function to flush and close the file; false if any write failed
+    bool close() {
+        if (!file) return !failed;
+        flush();
+        if (fclose(file) != 0) failed = true;
+        file = nullptr;
+        return !failed;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    cout << "=== Poker Dataset Merger ===\n\n";
+
+    vector<string> inputs;
+    string outputPath;
+    string tempDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    int numThreads = static_cast<int>(thread::hardware_concurrency());
+    long long memoryMB = 256;
+    long long defaultTrials = 100;
+
+    // Command line options
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) numThreads = atoi(argv[++i]);
+        else if (arg == "--memory-mb" && i + 1 < argc) memoryMB = atoll(argv[++i]);
+        else if (arg == "--temp-dir" && i + 1 < argc) tempDir = argv[++i];
+        else if (arg == "--trials" && i + 1 < argc) defaultTrials = atoll(argv[++i]);
+        else if (!arg.empty() && arg[0] != '-') inputs.push_back(arg);
+        else {
+            inputs.clear();
+            break;
+        }
+    }
+    if (inputs.empty() || outputPath.empty()) {
+        cerr << "Usage: " << argv[0] << " --output path [--threads N] [--memory-mb N] [--temp-dir dir]"
+            << " [--trials N] input.csv [input.csv ...]" << endl;
+        return 1;
+    }
+    if (numThreads <= 0) numThreads = 1;
+    if (memoryMB <= 0) memoryMB = 256;
+    if (defaultTrials <= 0) defaultTrials = 100;
+
+    // Blocks alive at once: one being read, a queue of numThreads and one per
+    // worker; a parsed block takes roughly twice its text size
+    const size_t queueCapacity = static_cast<size_t>(numThreads);
+    size_t blocksAlive = 1 + BoundedQueue<TextBlock*>(queueCapacity, 1).capacity() + numThreads;
+    size_t blockBytes = max<size_t>(static_cast<size_t>(memoryMB) * 1024 * 1024 / (3 * blocksAlive), 64 * 1024);
+
+    string tempTemplate = tempDir + "/poker-merge-XXXXXX";
+    if (!mkdtemp(tempTemplate.data())) {
+        cerr << "Failed to create a temporary directory in " << tempDir << endl;
+        return 1;
+    }
+    const string runDir = tempTemplate;
+    atomic<int> runCounter{ 0 };
+    auto newRunPath = [&] {
+        return runDir + "/run-" + to_string(runCounter++) + ".bin";
+        };
+    vector<string> allRuns; // Every run file created, for cleanup
+    auto cleanup = [&] {
+        for (const auto& path : allRuns) remove(path.c_str());
+        rmdir(runDir.c_str());
+        };
+
+    auto start = chrono::steady_clock::now();
+    auto secondsSince = [](chrono::steady_clock::time_point from) {
+        return chrono::duration<double>(chrono::steady_clock::now() - from).count();
+        };
+
+    // Phase 1: parse, sort and spill runs
+    vector<unique_ptr<DatasetLayout>> layouts;
+    BoundedQueue<TextBlock*> blocks(queueCapacity, 1);
+    mutex runMutex;
+    vector<string> runs;
+    atomic<long long> rowsRead{ 0 }, badRows{ 0 };
+    atomic<bool> writeFailed{ false };
+
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; ++t) {
+        workers.emplace_back([&] {
+            vector<MergeRecord> records;
+            vector<string_view> fields;
+            TextBlock* block;
+            long long waited;
+            while (blocks.pop(block, waited)) {
+                records.clear();
+                string_view text = block->text;
+                while (!text.empty()) {
+                    size_t end = text.find('\n');
+                    string_view line = text.substr(0, end);
+                    text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+                    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                    if (line.empty()) continue;
+
+                    MergeRecord record;
+                    const char* error = parseRow(line, *block->layout, fields, record);
+                    if (error) {
+                        if (badRows++ < 5) {
+                            lock_guard<mutex> lock(runMutex);
+                            cerr << block->layout->path << ": skipping row (" << error << "): " << line << "\n";
+                        }
+                        continue;
+                    }
+                    records.push_back(record);
+                }
+                rowsRead += static_cast<long long>(records.size());
+                delete block;
+
+                sortAndCombine(records);
+                if (records.empty()) continue;
+                string path = newRunPath();
+                bool ok = writeRun(path, records);
+                lock_guard<mutex> lock(runMutex);
+                allRuns.push_back(path);
+                if (ok) runs.push_back(path);
+                else writeFailed = true;
+            }
+            });
+    }
+
+    // Reader: cut each input into blocks of whole lines
+    bool readFailed = false;
+    for (const auto& path : inputs) {
+        layouts.emplace_back(new DatasetLayout());
+        DatasetLayout* layout = layouts.back().get();
+        layout->path = path;
+        layout->defaultTrials = defaultTrials;
+
+        DatasetBlockReader reader;
+        string header, error;
+        if (!reader.open(path, blockBytes, header, error) || !parseDatasetHeader(header, *layout, error)) {
+            cerr << path << ": " << error << endl;
+            readFailed = true;
+            break;
+        }
+        TextBlock* block = new TextBlock{ layout, string() };
+        while (reader.next(block->text)) {
+            blocks.push(block);
+            block = new TextBlock{ layout, string() };
+        }
+        delete block;
+    }
+    blocks.producerDone();
+    for (auto& worker : workers) worker.join();
+
+    if (readFailed || writeFailed) {
+        if (writeFailed) cerr << "Failed to write a run file in " << runDir << endl;
+        cleanup();
+        return 1;
+    }
+    double sortSeconds = secondsSince(start);
+    size_t initialRuns = runs.size();
+
+    // Phase 2: merge runs in parallel passes until one pass can finish the job
+    auto bufferRecordsFor = [&](size_t readers) {
+        return max<size_t>(static_cast<size_t>(memoryMB) * 1024 * 1024 / (2 * max<size_t>(readers, 1) * sizeof(MergeRecord)), 256);
+        };
+    int passes = 0;
+    while (runs.size() > MAX_MERGE_FAN_IN) {
+        ++passes;
+        size_t groups = (runs.size() + MAX_MERGE_FAN_IN - 1) / MAX_MERGE_FAN_IN;
+        vector<string> merged(groups);
+        atomic<size_t> nextGroup{ 0 };
+        int passThreads = static_cast<int>(min<size_t>(groups, static_cast<size_t>(numThreads)));
+        size_t bufferRecords = bufferRecordsFor(MAX_MERGE_FAN_IN * passThreads);
+        vector<thread> mergers;
+        for (int t = 0; t < passThreads; ++t) {
+            mergers.emplace_back([&] {
+                for (size_t g = nextGroup++; g < groups; g = nextGroup++) {
+                    vector<string> group(runs.begin() + g * MAX_MERGE_FAN_IN,
+                        runs.begin() + min(runs.size(), (g + 1) * MAX_MERGE_FAN_IN));
+                    string path = newRunPath();
+                    {
+                        lock_guard<mutex> lock(runMutex);
+                        allRuns.push_back(path);
+                    }
+                    FILE* file = fopen(path.c_str(), "wb");
+                    bool ok = file != nullptr && mergeRuns(group, bufferRecords, [&](const MergeRecord& record) {
+                        if (fwrite(&record, sizeof(record), 1, file) != 1) writeFailed = true;
+                        });
+                    if (!file || fclose(file) != 0 || !ok) writeFailed = true;
+                    merged[g] = path;
+                    for (const auto& run : group) remove(run.c_str());
+                }
+                });
+        }
+        for (auto& merger : mergers) merger.join();
+        if (writeFailed) {
+            cerr << "Failed to write a run file in " << runDir << endl;
+            cleanup();
+            return 1;
+        }
+        runs = move(merged);
+    }
+
+    // Final pass straight into the output
+    // Only backends every input has results for can be pooled
+    int commonBackends = (1 << EVAL_BACKEND_COUNT) - 1;
+    for (const auto& layout : layouts) commonBackends &= layout->backendMask;
+    if (commonBackends == 0) {
+        cerr << "The inputs have no evaluator backend in common." << endl;
+        cleanup();
+        return 1;
+    }
+
+    MergedCsvWriter writer;
+    if (!writer.open(outputPath, commonBackends)) {
+        cerr << "Failed to open " << outputPath << " for writing." << endl;
+        cleanup();
+        return 1;
+    }
+    long long uniqueSpots = 0, pooledTrials = 0;
+    bool merged = mergeRuns(runs, bufferRecordsFor(runs.size()), [&](const MergeRecord& record) {
+        writer.write(record);
+        uniqueSpots++;
+        pooledTrials += record.trials;
+        });
+    bool written = writer.close();
+    cleanup();
+    if (!merged || !written) {
+        cerr << "Failed to merge into " << outputPath << endl;
+        return 1;
+    }
+    double totalSeconds = secondsSince(start);
+
+    cout << "Read " << rowsRead.load() << " rows from " << inputs.size() << " file(s)";
+    if (badRows > 0) cout << ", skipped " << badRows.load() << " malformed";
+    cout << ".\n";
+    cout << "Sorted into " << initialRuns << " run(s) on " << numThreads << " threads in " << sortSeconds << " s";
+    if (passes > 0) cout << ", " << passes << " intermediate merge pass(es)";
+    cout << ".\n";
+    cout << "Wrote " << uniqueSpots << " canonical spots (" << (rowsRead - uniqueSpots) << " duplicates pooled, "
+        << pooledTrials << " trials per backend) to " << outputPath << " in " << totalSeconds << " s.\n";
+    return 0;
+}
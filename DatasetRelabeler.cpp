@@ -0,0 +1,313 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
+#include "PokerSimulator.h"
+#include "DatasetCsv.h"
+#include "Pipeline.h"
+
+using namespace std;
+
+// Tool to append the exact equity of every dataset row; preflop results are
+// memoised by canonical spot.
+
+// Structure to represent a numbered block of input lines and, once
+// labelled, its output text
+struct RelabelBlock {
+    long long sequence = 0;
+    string text;
+    string output;
+};
+
+// PreflopMemo class to share enumerated preflop results between workers;
+// the table is split into shards so lookups rarely contend. The first
+// worker to ask for a class claims it, and later ones wait for its result
+// instead of enumerating the same class again.
+class PreflopMemo {
+private:
+    static constexpr int SHARDS = 64;
+
+    struct Entry {
+        ExactEquity result;
+        bool ready = false; // False while the claiming worker enumerates
+    };
+
+    struct Shard {
+        mutex lock;
+        condition_variable readyChanged;
+        unordered_map<SpotKey, Entry, SpotKeyHash> results;
+    };
+    Shard shards[SHARDS];
+
+    Shard& shardFor(const SpotKey& key) {
+        return shards[SpotKeyHash()(key) % SHARDS];
+    }
+
+public:
+    // Function to get a memoised result, waiting if another worker is
+    // computing it. Returns false when the caller has claimed the key and
+    // must compute it and pass it to store().
+    bool claim(const SpotKey& key, ExactEquity& result) {
+        Shard& shard = shardFor(key);
+        unique_lock<mutex> guard(shard.lock);
+        auto inserted = shard.results.try_emplace(key);
+        if (inserted.second) return false;
+        shard.readyChanged.wait(guard, [&] { return shard.results[key].ready; });
+        result = shard.results[key].result;
+        return true;
+    }
+
+    void store(const SpotKey& key, const ExactEquity& result) {
+        Shard& shard = shardFor(key);
+        {
+            lock_guard<mutex> guard(shard.lock);
+            Entry& entry = shard.results[key];
+            entry.result = result;
+            entry.ready = true;
+        }
+        shard.readyChanged.notify_all();
+    }
+};
+
+// Structure to hold the counters of a relabelling run
+struct RelabelStats {
+    atomic<long long> rows{ 0 };
+    atomic<long long> badRows{ 0 };
+    atomic<long long> memoHits{ 0 };
+    atomic<long long> cacheHits{ 0 };
+    atomic<long long> enumerated{ 0 };
+    atomic<long long> boards{ 0 };
+};
+
+// Function to find the exact equity of a spot: from the memo or the cache
+// when possible, otherwise by enumeration
+ExactEquity exactEquityOf(const DatasetEntry& entry, PreflopMemo& memo, EquityCache& cache, RelabelStats& stats) {
+    ExactEquity result;
+    bool preflop = entry.boardCount == 0;
+    bool keyed = preflop || cache.isOpen();
+    SpotKey key{};
+    if (keyed) key = canonicalSpot(entry.board, entry.player1, entry.player2);
+    if (preflop && memo.claim(key, result)) {
+        stats.memoHits++;
+        return result;
+    }
+    CachedEquity cached;
+    if (cache.isOpen() && cache.lookup(key, cached) && cached.exact) {
+        result.p1Wins = static_cast<long long>(cached.p1Wins);
+        result.p2Wins = static_cast<long long>(cached.p2Wins);
+        result.ties = static_cast<long long>(cached.ties);
+        result.boards = static_cast<long long>(cached.trials);
+        stats.cacheHits++;
+    }
+    else {
+        result = enumerateEquityExact(entry.board, entry.player1, entry.player2);
+        stats.enumerated++;
+        stats.boards += result.boards;
+        if (cache.isOpen()) {
+            CachedEquity add, merged;
+            add.p1Wins = static_cast<uint64_t>(result.p1Wins);
+            add.p2Wins = static_cast<uint64_t>(result.p2Wins);
+            add.ties = static_cast<uint64_t>(result.ties);
+            add.trials = static_cast<uint64_t>(result.boards);
+            add.exact = true;
+            cache.merge(key, add, merged);
+        }
+    }
+    if (preflop) memo.store(key, result);
+    return result;
+}
+
+// Function to append a percentage the way the generator writes it (%g, 6 significant digits)
+void appendPercent(string& out, long long count, long long total) {
+    char buffer[64];
+    double value = total > 0 ? count / static_cast<double>(total) * 100.0 : 0.0;
+    out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value, chars_format::general, 6).ptr - buffer);
+}
+
+// Function to label every line of a block into its output text. Malformed
+// rows are copied with the exact columns left empty.
+void relabelBlock(RelabelBlock& block, const DatasetLayout& layout, PreflopMemo& memo, EquityCache& cache, RelabelStats& stats) {
+    vector<string_view> fields;
+    string_view text = block.text;
+    block.output.clear();
+    block.output.reserve(block.text.size() + block.text.size() / 3);
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        block.output.append(line.data(), line.size());
+        DatasetEntry entry;
+        if (parseDatasetRow(line, layout, fields, entry)) {
+            stats.badRows++;
+            block.output += ",,,,\n";
+            continue;
+        }
+        ExactEquity exact = exactEquityOf(entry, memo, cache, stats);
+        block.output += ',';
+        appendPercent(block.output, exact.p1Wins, exact.boards);
+        block.output += ',';
+        appendPercent(block.output, exact.p2Wins, exact.boards);
+        block.output += ',';
+        appendPercent(block.output, exact.ties, exact.boards);
+        block.output += ',';
+        char buffer[32];
+        block.output.append(buffer, to_chars(buffer, buffer + sizeof(buffer), exact.boards).ptr - buffer);
+        block.output += '\n';
+        stats.rows++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    cout << "=== Poker Dataset Exact Relabeler ===\n\n";
+
+    string inputPath;
+    string outputPath;
+    string cachePath;
+    int numThreads = static_cast<int>(thread::hardware_concurrency());
+    size_t blockBytes = 1 << 20;
+
+    // Command line options
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) numThreads = atoi(argv[++i]);
+        else if (arg == "--cache" && i + 1 < argc) cachePath = argv[++i];
+        else if (arg == "--block-kb" && i + 1 < argc) blockBytes = static_cast<size_t>(atol(argv[++i])) * 1024;
+        else if (!arg.empty() && arg[0] != '-' && inputPath.empty()) inputPath = arg;
+        else {
+            inputPath.clear();
+            break;
+        }
+    }
+    if (inputPath.empty() || outputPath.empty()) {
+        cerr << "Usage: " << argv[0] << " --output path [--threads N] [--cache path] [--block-kb N] input.csv" << endl;
+        return 1;
+    }
+    if (numThreads <= 0) numThreads = 1;
+    if (blockBytes == 0) blockBytes = 1 << 20;
+
+    EquityCache cache;
+    if (!cachePath.empty()) {
+        string error;
+        if (!cache.open(cachePath, EquityCache::DEFAULT_SLOTS, error)) {
+            cerr << "Failed to open equity cache: " << error << endl;
+            return 1;
+        }
+    }
+
+    DatasetBlockReader reader;
+    DatasetLayout layout;
+    string header, error;
+    if (!reader.open(inputPath, blockBytes, header, error) || !parseDatasetHeader(header, layout, error)) {
+        cerr << inputPath << ": " << error << endl;
+        return 1;
+    }
+    if (header.find("P1Win_Exact") != string::npos) {
+        cerr << inputPath << " already has exact columns." << endl;
+        return 1;
+    }
+
+    FILE* output = fopen(outputPath.c_str(), "wb");
+    if (!output) {
+        cerr << "Failed to open " << outputPath << " for writing." << endl;
+        return 1;
+    }
+    bool writeFailed = false;
+    auto write = [&](const string& text) {
+        if (!text.empty() && fwrite(text.data(), 1, text.size(), output) != text.size()) writeFailed = true;
+        };
+    write(header + ",P1Win_Exact,P2Win_Exact,Tie_Exact,Boards_Exact\n");
+
+    // Reader -> workers -> writer. Both queues hold a few blocks per worker,
+    // and a worker may not start a block more than maxAhead blocks past the
+    // writer, so a slow early block cannot make the reorder buffer grow.
+    const size_t queueCapacity = static_cast<size_t>(numThreads) * 2;
+    const long long maxAhead = static_cast<long long>(numThreads) * 4;
+    atomic<long long> written{ 0 };
+    BoundedQueue<RelabelBlock*> inputQueue(queueCapacity, 1);
+    BoundedQueue<RelabelBlock*> outputQueue(queueCapacity, numThreads);
+    PreflopMemo memo;
+    RelabelStats stats;
+    auto start = chrono::steady_clock::now();
+
+    thread readerThread([&] {
+        long long sequence = 0;
+        unique_ptr<RelabelBlock> block(new RelabelBlock());
+        while (reader.next(block->text)) {
+            block->sequence = sequence++;
+            inputQueue.push(block.release());
+            block.reset(new RelabelBlock());
+        }
+        inputQueue.producerDone();
+        });
+
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; ++t) {
+        workers.emplace_back([&] {
+            RelabelBlock* block;
+            long long waited;
+            while (inputQueue.pop(block, waited)) {
+                for (int round = 0; block->sequence >= written + maxAhead; ++round) pipelineBackoff(round);
+                relabelBlock(*block, layout, memo, cache, stats);
+                block->text.clear();
+                block->text.shrink_to_fit();
+                outputQueue.push(block);
+            }
+            outputQueue.producerDone();
+            });
+    }
+
+    // Writer (this thread): blocks finish out of order and are written in input order
+    map<long long, unique_ptr<RelabelBlock>> reorder;
+    RelabelBlock* done;
+    long long waited;
+    auto lastReport = chrono::steady_clock::now();
+    while (outputQueue.pop(done, waited)) {
+        reorder[done->sequence].reset(done);
+        while (!reorder.empty() && reorder.begin()->first == written) {
+            write(reorder.begin()->second->output);
+            reorder.erase(reorder.begin());
+            written++;
+        }
+        if (chrono::steady_clock::now() - lastReport > chrono::seconds(5)) {
+            lastReport = chrono::steady_clock::now();
+            cout << "  " << stats.rows.load() << " rows labelled..." << endl;
+        }
+    }
+    readerThread.join();
+    for (auto& worker : workers) worker.join();
+    if (fclose(output) != 0) writeFailed = true;
+    if (writeFailed) {
+        cerr << "Failed to write " << outputPath << endl;
+        return 1;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << fixed << setprecision(2);
+    cout << "Labelled " << stats.rows.load() << " rows in " << seconds << " s on " << numThreads << " threads ("
+        << stats.rows / max(seconds, 1e-9) << " rows/s).\n";
+    cout << "Enumerated " << stats.enumerated.load() << " spots (" << stats.boards.load() << " boards); "
+        << stats.memoHits.load() << " preflop rows reused a memoised result";
+    if (cache.isOpen()) cout << ", " << stats.cacheHits.load() << " came from the cache";
+    cout << ".\n";
+    if (stats.badRows > 0)
+        cout << stats.badRows.load() << " malformed rows were copied with empty exact columns.\n";
+    cout << "Results saved to '" << outputPath << "'.\n";
+    return 0;
+}
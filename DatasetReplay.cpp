@@ -0,0 +1,262 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "PokerSimulator.h"
+#include "DatasetCsv.h"
+#include "ThreadAffinity.h"
+
+using namespace std;
+
+// Tool to replay a dataset as a benchmark workload and report throughput, latency
+// and error against a reference.
+
+// Engines a replay can run: a Monte Carlo backend, or exact enumeration
+const int EXACT_ENGINE = EVAL_BACKEND_COUNT;
+
+// Number of game stages (PREFLOP-RIVER)
+const int STAGE_COUNT = 4;
+
+// Game stage by number of community cards; the loader rejects 1 and 2
+const GameStage STAGE_BY_BOARD_COUNT[6] = { PREFLOP, PREFLOP, PREFLOP, FLOP, TURN, RIVER };
+
+// Structure to represent one spot of the workload, prepared for the engines
+struct ReplaySpot {
+    DatasetEntry entry;
+    vector<Card> player1Hand;
+    vector<Card> player2Hand;
+    vector<Card> communityCards;
+    string gameStage;
+    GameStage stage = PREFLOP;
+    double reference[3] = {}; // P1 win, P2 win and tie in percent
+};
+
+// Structure to hold the outcome of one timed run of a spot
+struct ReplayResult {
+    long long latencyNanos = 0;
+    double percent[3] = {};
+};
+
+// Function to get player 1's equity (wins plus half the ties) in percent
+double equityOf(const double* percent) {
+    return percent[0] + percent[2] / 2.0;
+}
+
+// Function to get the nearest-rank percentile of sorted values
+long long percentile(const vector<long long>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(ceil(p * sorted.size()));
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+// Function to run one spot through the engine
+void runSpot(const ReplaySpot& spot, int engine, int trials, ReplayResult& result) {
+    auto start = chrono::steady_clock::now();
+    if (engine == EXACT_ENGINE) {
+        ExactEquity exact = enumerateEquityExact(spot.entry.board, spot.entry.player1, spot.entry.player2);
+        double boards = static_cast<double>(max(exact.boards, 1LL));
+        result.percent[0] = exact.p1Wins / boards * 100.0;
+        result.percent[1] = exact.p2Wins / boards * 100.0;
+        result.percent[2] = exact.ties / boards * 100.0;
+    }
+    else {
+        Simulator simulator(spot.player1Hand, spot.player2Hand, spot.gameStage, spot.communityCards);
+        int p1Wins = 0, p2Wins = 0, ties = 0;
+        simulator.runTrials(static_cast<EvaluatorBackend>(engine), trials, p1Wins, p2Wins, ties);
+        result.percent[0] = p1Wins / static_cast<double>(trials) * 100.0;
+        result.percent[1] = p2Wins / static_cast<double>(trials) * 100.0;
+        result.percent[2] = ties / static_cast<double>(trials) * 100.0;
+    }
+    result.latencyNanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+// Function to run work items 0..count-1 on numThreads threads claiming from a shared counter
+template<typename Work>
+void runParallel(long long count, int numThreads, bool pinThreads, const CpuTopology& topology, Work work) {
+    atomic<long long> next{ 0 };
+    vector<thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t] {
+            if (pinThreads) pinCurrentThread(topology, t);
+            for (long long i = next++; i < count; i = next++) work(i);
+            });
+    }
+    for (auto& thread : threads) thread.join();
+}
+
+int main(int argc, char* argv[]) {
+    cout << "=== Poker Dataset Replay ===\n\n";
+
+    string inputPath = "../PokerOddsDataset.csv";
+    string engineName = "seven";
+    int numThreads = static_cast<int>(thread::hardware_concurrency());
+    bool pinThreads = false;
+    int trials = 10000;
+    int passes = 1;
+    string referenceName = "exact";
+
+    // Command line options
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--input" && i + 1 < argc) inputPath = argv[++i];
+        else if (arg == "--engine" && i + 1 < argc) engineName = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) numThreads = atoi(argv[++i]);
+        else if (arg == "--pin-threads") pinThreads = true;
+        else if (arg == "--trials" && i + 1 < argc) trials = atoi(argv[++i]);
+        else if (arg == "--passes" && i + 1 < argc) passes = atoi(argv[++i]);
+        else if (arg == "--reference" && i + 1 < argc) referenceName = argv[++i];
+        else {
+            cerr << "Usage: " << argv[0] << " [--input path] [--engine map|hash|seven|exact] [--threads N]"
+                << " [--pin-threads] [--trials N] [--passes N] [--reference exact|recorded]" << endl;
+            return 1;
+        }
+    }
+    if (numThreads <= 0) numThreads = 1;
+    if (trials <= 0) trials = 10000;
+    if (passes <= 0) passes = 1;
+
+    int engine = EXACT_ENGINE;
+    EvaluatorBackend backend;
+    if (parseEvaluatorBackend(engineName, backend)) engine = backend;
+    else if (engineName != "exact") {
+        cerr << "Unknown engine '" << engineName << "' (expected map, hash, seven or exact)" << endl;
+        return 1;
+    }
+    if (referenceName != "exact" && referenceName != "recorded") {
+        cerr << "Unknown reference '" << referenceName << "' (expected exact or recorded)" << endl;
+        return 1;
+    }
+    bool exactReference = referenceName == "exact";
+
+    // Load the workload
+    DatasetLayout layout;
+    vector<DatasetEntry> entries;
+    long long badRows = 0;
+    string error;
+    if (!loadDataset(inputPath, layout, entries, badRows, error)) {
+        cerr << "Failed to load dataset: " << error << endl;
+        return 1;
+    }
+    if (entries.empty()) {
+        cerr << "No spots in " << inputPath << endl;
+        return 1;
+    }
+
+    vector<ReplaySpot> spots(entries.size());
+    int stageCounts[STAGE_COUNT] = {};
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ReplaySpot& spot = spots[i];
+        spot.entry = entries[i];
+        spot.player1Hand = cardsFromMask(spot.entry.player1);
+        spot.player2Hand = cardsFromMask(spot.entry.player2);
+        spot.communityCards = cardsFromMask(spot.entry.board);
+        spot.gameStage = DATASET_STAGE_NAMES[spot.entry.boardCount];
+        spot.stage = STAGE_BY_BOARD_COUNT[spot.entry.boardCount];
+        stageCounts[spot.stage]++;
+
+        // Recorded reference: the recorded backends pooled (they ran the same trial count)
+        int recorded = 0;
+        for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+            if (!(layout.backendMask & (1 << b))) continue;
+            for (int c = 0; c < 3; ++c) spot.reference[c] += spot.entry.percent[b][c];
+            recorded++;
+        }
+        for (int c = 0; c < 3; ++c) spot.reference[c] /= recorded;
+    }
+
+    cout << "Loaded " << spots.size() << " spots from " << inputPath << " (" << stageCounts[PREFLOP] << " preflop, "
+        << stageCounts[FLOP] << " flop, " << stageCounts[TURN] << " turn, " << stageCounts[RIVER] << " river)";
+    if (badRows > 0) cout << ", skipped " << badRows << " malformed rows";
+    cout << ".\n";
+
+    CpuTopology topology = detectCpuTopology();
+    if (exactReference) {
+        auto start = chrono::steady_clock::now();
+        runParallel(static_cast<long long>(spots.size()), numThreads, pinThreads, topology, [&](long long i) {
+            ReplayResult exact;
+            runSpot(spots[i], EXACT_ENGINE, 0, exact);
+            copy(exact.percent, exact.percent + 3, spots[i].reference);
+            });
+        cout << "Computed exact reference equities in "
+            << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s.\n";
+    }
+
+    cout << "Replaying with engine " << engineName;
+    if (engine != EXACT_ENGINE) cout << " (" << trials << " trials per spot)";
+    cout << " on " << numThreads << " threads, " << passes << " pass(es)...\n";
+
+    // Timed replay: every spot once per pass
+    const long long workItems = static_cast<long long>(spots.size()) * passes;
+    vector<ReplayResult> results(workItems);
+    auto replayStart = chrono::steady_clock::now();
+    runParallel(workItems, numThreads, pinThreads, topology, [&](long long i) {
+        runSpot(spots[i % spots.size()], engine, trials, results[i]);
+        });
+    double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - replayStart).count();
+
+    // Latency and accuracy per stage, then overall (index STAGE_COUNT)
+    static const char* stageLabels[STAGE_COUNT + 1] = { "preflop", "flop", "turn", "river", "all" };
+    vector<long long> latencies[STAGE_COUNT + 1];
+    double absErrorSum[STAGE_COUNT + 1] = {}, squaredErrorSum[STAGE_COUNT + 1] = {}, maxError[STAGE_COUNT + 1] = {};
+    double standardErrorSum[STAGE_COUNT + 1] = {};
+    for (long long i = 0; i < workItems; ++i) {
+        const ReplaySpot& spot = spots[i % spots.size()];
+        double deviation = fabs(equityOf(results[i].percent) - equityOf(spot.reference));
+        double standardError = engine == EXACT_ENGINE ? 0.0 :
+            100.0 * equityStandardError(spot.reference[0] / 100.0, spot.reference[2] / 100.0, trials);
+        for (int s : { static_cast<int>(spot.stage), STAGE_COUNT }) {
+            latencies[s].push_back(results[i].latencyNanos);
+            absErrorSum[s] += deviation;
+            squaredErrorSum[s] += deviation * deviation;
+            maxError[s] = max(maxError[s], deviation);
+            standardErrorSum[s] += standardError;
+        }
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "\nThroughput: " << workItems / wallSeconds << " spots/s";
+    if (engine != EXACT_ENGINE) cout << ", " << workItems * static_cast<double>(trials) / wallSeconds << " trials/s";
+    cout << " (" << wallSeconds << " s)\n";
+
+    cout << "\n--- Latency per spot (us) ---\n";
+    cout << left << setw(9) << "Stage" << right << setw(8) << "Spots" << setw(12) << "Mean" << setw(12) << "p50"
+        << setw(12) << "p99" << setw(12) << "Max" << "\n";
+    for (int s = 0; s <= STAGE_COUNT; ++s) {
+        vector<long long>& values = latencies[s];
+        if (values.empty()) continue;
+        sort(values.begin(), values.end());
+        double mean = 0.0;
+        for (long long value : values) mean += value;
+        mean /= values.size();
+        cout << left << setw(9) << stageLabels[s] << right << setw(8) << values.size() << setw(12) << mean / 1000.0
+            << setw(12) << percentile(values, 0.50) / 1000.0 << setw(12) << percentile(values, 0.99) / 1000.0
+            << setw(12) << values.back() / 1000.0 << "\n";
+    }
+
+    // Deviation of player 1's equity, in percentage points. ExpectedSE is
+    // the standard error the trial count alone predicts.
+    cout << "\n--- Equity deviation from " << (exactReference ? "exact" : "recorded") << " reference (points) ---\n";
+    cout << left << setw(9) << "Stage" << right << setw(12) << "MeanAbs" << setw(12) << "RMS" << setw(12) << "Max"
+        << setw(12) << "ExpectedSE" << "\n";
+    for (int s = 0; s <= STAGE_COUNT; ++s) {
+        double n = static_cast<double>(latencies[s].size());
+        if (n == 0) continue;
+        cout << left << setw(9) << stageLabels[s] << right << setw(12) << absErrorSum[s] / n
+            << setw(12) << sqrt(squaredErrorSum[s] / n) << setw(12) << maxError[s]
+            << setw(12) << standardErrorSum[s] / n << "\n";
+    }
+    if (!exactReference)
+        cout << "(Recorded equities carry their own sampling error, which is included above.)\n";
+
+    cout << "\nReplay score: " << workItems / wallSeconds << " spots/s, p99 "
+        << percentile(latencies[STAGE_COUNT], 0.99) / 1000.0 << " us, mean |error| "
+        << absErrorSum[STAGE_COUNT] / workItems << " points\n";
+    return 0;
+}
@@ -0,0 +1,316 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+#include "PokerSimulator.h"
+#include "ThreadAffinity.h"
+
+// Tool to check evaluator backends against evaluateHandGeneric over all
+// 133,784,560 seven-card hands, split into items by the two lowest cards.
+
+const long long SEVEN_CARD_HANDS = 133784560LL;
+
+// Known number of seven-card hands per category (index 1-9)
+const long long KNOWN_CATEGORY_TOTALS[10] = {
+    0, 23294460, 58627800, 31433400, 6461620, 6180020, 4047644, 3473184, 224848, 41584
+};
+
+// Known number of distinct hand values per category (index 1-9)
+const int KNOWN_CATEGORY_CLASSES[10] = { 0, 407, 1470, 763, 575, 10, 1277, 156, 156, 10 };
+
+// Packed scores fit in 24 bits (category 9 << 20 and five 4-bit ranks)
+const int SCORE_SPACE = 1 << 24;
+
+// Enumeration for the evaluators taking part; the reference is always first
+enum ValidatedBackend { REFERENCE, HASH_BACKEND, SEVEN_CARD_BACKEND, FIVE_CARD_BACKEND, BACKEND_COUNT };
+
+const char* const BACKEND_NAMES[BACKEND_COUNT] = { "reference", "hash", "seven", "five" };
+
+// Function to pack a HandValue the way FiveCardEvaluator does
+int packHandValue(const HandValue& hv) {
+    int t[5] = { 0, 0, 0, 0, 0 };
+    for (size_t i = 0; i < hv.tiebreakers.size() && i < 5; ++i) t[i] = hv.tiebreakers[i];
+    return FiveCardEvaluator::pack(hv.category, t[0], t[1], t[2], t[3], t[4]);
+}
+
+// Function to describe a packed score, e.g. "Full House [7 12]"
+string describeScore(int score) {
+    int category = score >> 20;
+    stringstream ss;
+    ss << (category >= 1 && category <= 9 ? HAND_CATEGORY_NAMES[category] : "Invalid") << " [";
+    for (int shift = 16, first = 1; shift >= 0; shift -= 4) {
+        int rank = (score >> shift) & 0xF;
+        if (rank == 0) continue;
+        if (!first) ss << " ";
+        ss << rank;
+        first = 0;
+    }
+    ss << "]";
+    return ss.str();
+}
+
+// Function to score seven cards as the best of their 21 five-card subsets
+int bestOfFiveCards(const int* ranks, const int* suits) {
+    int best = 0;
+    for (int skipA = 0; skipA < 7; ++skipA) {
+        for (int skipB = skipA + 1; skipB < 7; ++skipB) {
+            int r[5], s[5], n = 0;
+            for (int c = 0; c < 7; ++c) {
+                if (c == skipA || c == skipB) continue;
+                r[n] = ranks[c];
+                s[n++] = suits[c];
+            }
+            bool flush = s[0] == s[1] && s[0] == s[2] && s[0] == s[3] && s[0] == s[4];
+            best = max(best, FiveCardEvaluator::score(r[0], r[1], r[2], r[3], r[4], flush));
+        }
+    }
+    return best;
+}
+
+// Structure to represent a hand a backend scored differently
+struct Mismatch {
+    int backend;
+    string cards;
+    int expected;
+    int actual;
+};
+
+// Structure to hold one thread's results
+struct ValidationTally {
+    long long categoryCounts[BACKEND_COUNT][10] = {};
+    vector<uint64_t> seenScores[BACKEND_COUNT]; // Bitmap over the score space
+    long long mismatchCount[BACKEND_COUNT] = {};
+    vector<Mismatch> mismatches;
+};
+
+// Function to validate every hand whose two lowest cards are (first, second)
+void validateItem(int first, int second, const bool* enabled, size_t maxMismatches, ValidationTally& tally) {
+    HandEvaluator evaluator;
+    vector<Card> hand(7, cardFromIndex(0));
+    int ranks[7], suits[7];
+    int index[7] = { first, second };
+    auto place = [&](int slot, int cardIdx) {
+        index[slot] = cardIdx;
+        hand[slot] = cardFromIndex(cardIdx);
+        ranks[slot] = hand[slot].rank;
+        suits[slot] = hand[slot].suit;
+        };
+    place(0, first);
+    place(1, second);
+
+    for (int c = second + 1; c < 48; ++c) {
+        place(2, c);
+        for (int d = c + 1; d < 49; ++d) {
+            place(3, d);
+            for (int e = d + 1; e < 50; ++e) {
+                place(4, e);
+                for (int f = e + 1; f < 51; ++f) {
+                    place(5, f);
+                    for (int g = f + 1; g < 52; ++g) {
+                        place(6, g);
+                        int scores[BACKEND_COUNT] = {};
+                        scores[REFERENCE] = packHandValue(evaluator.evaluateHandMap(hand));
+                        if (enabled[HASH_BACKEND])
+                            scores[HASH_BACKEND] = packHandValue(evaluator.evaluateHandHash(hand));
+                        if (enabled[SEVEN_CARD_BACKEND]) {
+                            uint64_t mask = 0;
+                            for (int i = 0; i < 7; ++i) mask |= 1ULL << index[i];
+                            scores[SEVEN_CARD_BACKEND] = SevenCardEvaluator::score(mask);
+                        }
+                        if (enabled[FIVE_CARD_BACKEND])
+                            scores[FIVE_CARD_BACKEND] = bestOfFiveCards(ranks, suits);
+
+                        for (int b = 0; b < BACKEND_COUNT; ++b) {
+                            if (!enabled[b]) continue;
+                            int score = scores[b];
+                            int category = score >> 20;
+                            tally.categoryCounts[b][category >= 1 && category <= 9 ? category : 0]++;
+                            tally.seenScores[b][static_cast<unsigned>(score) % SCORE_SPACE / 64] |= 1ULL << (score % 64);
+                            if (b == REFERENCE || score == scores[REFERENCE]) continue;
+                            tally.mismatchCount[b]++;
+                            if (tally.mismatches.size() < maxMismatches) {
+                                string cards;
+                                for (const auto& card : hand) cards += cardToString(card) + " ";
+                                tally.mismatches.push_back({ b, cards, scores[REFERENCE], score });
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+    cout << "=== Poker Evaluator Validator ===\n\n";
+
+    int numThreads = static_cast<int>(thread::hardware_concurrency());
+    bool pinThreads = false;
+    size_t maxMismatches = 20;
+    int stride = 1;
+    bool enabled[BACKEND_COUNT] = { true, true, true, true };
+
+    // Command line options
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) numThreads = atoi(argv[++i]);
+        else if (arg == "--pin-threads") pinThreads = true;
+        else if (arg == "--max-mismatches" && i + 1 < argc) maxMismatches = static_cast<size_t>(atol(argv[++i]));
+        else if (arg == "--stride" && i + 1 < argc) stride = atoi(argv[++i]);
+        else if (arg == "--backends" && i + 1 < argc) {
+            // Comma-separated list of backends to check against the reference
+            for (int b = 1; b < BACKEND_COUNT; ++b) enabled[b] = false;
+            stringstream ss(argv[++i]);
+            string name;
+            while (getline(ss, name, ',')) {
+                bool known = false;
+                for (int b = 1; b < BACKEND_COUNT; ++b) {
+                    if (name == BACKEND_NAMES[b]) enabled[b] = known = true;
+                }
+                if (!known) {
+                    cerr << "Unknown backend '" << name << "' (expected hash, seven or five)" << endl;
+                    return 1;
+                }
+            }
+        }
+        else {
+            cerr << "Usage: " << argv[0] << " [--threads N] [--pin-threads] [--backends hash,seven,five]"
+                << " [--max-mismatches N] [--stride N]" << endl;
+            return 1;
+        }
+    }
+    if (numThreads <= 0) numThreads = 1;
+    if (stride <= 0) stride = 1;
+
+    // Work items: the two lowest cards of the hand, largest items first
+    vector<pair<int, int>> items;
+    for (int first = 0; first < 46; ++first) {
+        for (int second = first + 1; second < 47; ++second)
+            items.push_back({ first, second });
+    }
+    vector<pair<int, int>> selected;
+    for (size_t i = 0; i < items.size(); i += stride) selected.push_back(items[i]);
+
+    cout << "Validating";
+    for (int b = 1; b < BACKEND_COUNT; ++b) {
+        if (enabled[b]) cout << " " << BACKEND_NAMES[b];
+    }
+    cout << " against the reference on " << numThreads << " threads";
+    if (stride > 1) cout << " (every " << stride << "th of " << items.size() << " work items)";
+    cout << "...\n";
+
+    CpuTopology topology = detectCpuTopology();
+    vector<ValidationTally> tallies(numThreads);
+    atomic<size_t> nextItem{ 0 };
+    atomic<size_t> itemsDone{ 0 };
+    auto startTime = chrono::high_resolution_clock::now();
+
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; ++t) {
+        workers.emplace_back([&, t] {
+            if (pinThreads && !pinCurrentThread(topology, t))
+                cerr << "Failed to pin worker " << t << endl;
+            ValidationTally& tally = tallies[t];
+            for (int b = 0; b < BACKEND_COUNT; ++b) {
+                if (enabled[b]) tally.seenScores[b].assign(SCORE_SPACE / 64, 0);
+            }
+            while (true) {
+                size_t item = nextItem.fetch_add(1);
+                if (item >= selected.size()) break;
+                validateItem(selected[item].first, selected[item].second, enabled, maxMismatches, tally);
+                itemsDone++;
+            }
+            });
+    }
+
+    // Progress report while the workers run
+    size_t reported = 0;
+    while (itemsDone < selected.size()) {
+        this_thread::sleep_for(chrono::milliseconds(200));
+        size_t done = itemsDone;
+        if (done * 10 / selected.size() > reported * 10 / selected.size()) {
+            auto elapsed = chrono::duration_cast<chrono::seconds>(chrono::high_resolution_clock::now() - startTime).count();
+            cout << "  " << done * 100 / selected.size() << "% of work items done (" << elapsed << " s)" << endl;
+            reported = done;
+        }
+    }
+    for (auto& worker : workers) worker.join();
+    auto endTime = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count() / 1000.0;
+
+    // Merge the per-thread tallies
+    ValidationTally total;
+    for (int b = 0; b < BACKEND_COUNT; ++b) {
+        if (enabled[b]) total.seenScores[b].assign(SCORE_SPACE / 64, 0);
+    }
+    for (const auto& tally : tallies) {
+        for (int b = 0; b < BACKEND_COUNT; ++b) {
+            if (!enabled[b]) continue;
+            for (int c = 0; c < 10; ++c) total.categoryCounts[b][c] += tally.categoryCounts[b][c];
+            for (size_t w = 0; w < total.seenScores[b].size(); ++w) total.seenScores[b][w] |= tally.seenScores[b][w];
+            total.mismatchCount[b] += tally.mismatchCount[b];
+        }
+        for (const auto& mismatch : tally.mismatches) {
+            if (total.mismatches.size() < maxMismatches) total.mismatches.push_back(mismatch);
+        }
+    }
+
+    long long hands = 0;
+    for (int c = 0; c < 10; ++c) hands += total.categoryCounts[REFERENCE][c];
+    bool fullSweep = stride == 1;
+    cout << "\nEvaluated " << hands << " hands per backend in " << seconds << " s ("
+        << static_cast<long long>(hands / max(seconds, 0.001)) << " hands/s per backend).\n";
+
+    // Category totals and distinct values per backend
+    bool allPassed = true;
+    for (int b = 0; b < BACKEND_COUNT; ++b) {
+        if (!enabled[b]) continue;
+        bool passed = total.mismatchCount[b] == 0;
+        cout << "\n--- " << BACKEND_NAMES[b] << " ---\n";
+        int totalClasses = 0;
+        for (int c = 1; c <= 9; ++c) {
+            int classes = 0;
+            for (int w = (c << 20) / 64; w < ((c + 1) << 20) / 64; ++w)
+                classes += __builtin_popcountll(total.seenScores[b][w]);
+            totalClasses += classes;
+            cout << HAND_CATEGORY_NAMES[c] << ": " << total.categoryCounts[b][c] << " hands, " << classes << " values";
+            if (fullSweep) {
+                bool matches = total.categoryCounts[b][c] == KNOWN_CATEGORY_TOTALS[c] && classes == KNOWN_CATEGORY_CLASSES[c];
+                if (!matches) {
+                    cout << " (expected " << KNOWN_CATEGORY_TOTALS[c] << " hands, " << KNOWN_CATEGORY_CLASSES[c] << " values)";
+                    passed = false;
+                }
+            }
+            cout << "\n";
+        }
+        if (total.categoryCounts[b][0] > 0) {
+            cout << "Invalid category: " << total.categoryCounts[b][0] << " hands\n";
+            passed = false;
+        }
+        cout << "Distinct values: " << totalClasses << "\n";
+        if (b != REFERENCE)
+            cout << "Hands differing from the reference: " << total.mismatchCount[b] << "\n";
+        if (fullSweep && hands != SEVEN_CARD_HANDS) passed = false;
+        cout << (passed ? "PASS" : "FAIL") << (fullSweep ? "" : " (partial sweep: totals not checked)") << "\n";
+        allPassed = allPassed && passed;
+    }
+
+    if (!total.mismatches.empty()) {
+        cout << "\nFirst mismatches:\n";
+        for (const auto& mismatch : total.mismatches) {
+            cout << BACKEND_NAMES[mismatch.backend] << ": " << mismatch.cards << "reference " << describeScore(mismatch.expected)
+                << ", got " << describeScore(mismatch.actual) << "\n";
+        }
+    }
+
+    cout << "\n" << (allPassed ? "All evaluators agree with the reference." : "Validation FAILED.") << "\n";
+    return allPassed ? 0 : 1;
+}
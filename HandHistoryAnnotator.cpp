@@ -0,0 +1,376 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "PokerSimulator.h"
+#include "Pipeline.h"
+
+using namespace std;
+
+// Tool to write the equity of every heads-up all-in that reached showdown in a
+// PokerStars-style hand-history log.
+
+// Structure to represent the all-in spot found in one hand
+struct AllInSpot {
+    string_view handID;
+    int boardAtAllIn = -1;      // Community cards out when the last player went all-in; -1 if nobody did
+    uint8_t board[5];           // Community cards in the order they were dealt
+    int boardCount = 0;
+    string_view names[2];
+    uint64_t holeCards[2] = {};
+    int shown = 0;              // Players who showed a two-card hand
+    bool unsupported = false;   // Some showing had other than two cards, or cards clashed
+};
+
+// Structure to represent a chunk of the log and, once processed, its output
+struct AnnotatedChunk {
+    long long sequence = 0;
+    string output;
+    long long hands = 0;
+    long long annotated = 0;
+    long long skipped = 0;      // All-ins that could not be annotated (multiway, non-hold'em, bad cards)
+};
+
+// Structure to hold the settings every worker shares
+struct AnnotateSettings {
+    int preflopTrials = 100000;
+};
+
+// Function to find the first hand boundary at or after pos: the position
+// just past the next blank line. Neighbouring chunks agree on it, so every
+// hand belongs to exactly one chunk.
+size_t handBoundary(string_view text, size_t pos) {
+    if (pos == 0) return 0;
+    if (pos >= text.size()) return text.size();
+    size_t lineStart = text.find('\n', pos - 1);
+    while (lineStart != string_view::npos) {
+        lineStart++;
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == string_view::npos) return text.size();
+        if (text.find_first_not_of(" \t\r", lineStart) >= lineEnd) return lineEnd + 1;
+        lineStart = lineEnd;
+    }
+    return text.size();
+}
+
+// Function to get the cards of the last [...] group on a line
+string_view lastBracketGroup(string_view line) {
+    size_t open = line.rfind('[');
+    if (open == string_view::npos) return string_view();
+    size_t close = line.find(']', open);
+    if (close == string_view::npos) return string_view();
+    return line.substr(open + 1, close - open - 1);
+}
+
+// Function to read one line of a hand into the spot being built
+void scanHandLine(string_view line, AllInSpot& spot, bool& atShowdown) {
+    static constexpr string_view HAND_MARKER = "Hand #";
+    static constexpr string_view SHOWS_MARKER = ": shows [";
+
+    if (spot.handID.empty()) {
+        size_t marker = line.find(HAND_MARKER);
+        if (marker != string_view::npos) {
+            size_t start = marker + HAND_MARKER.size();
+            size_t end = start;
+            while (end < line.size() && line[end] >= '0' && line[end] <= '9') ++end;
+            spot.handID = line.substr(start, end - start);
+            return;
+        }
+    }
+
+    if (line.compare(0, 4, "*** ") == 0) {
+        if (line.compare(4, 4, "FLOP") == 0 || line.compare(4, 4, "TURN") == 0 || line.compare(4, 5, "RIVER") == 0) {
+            CardParseResult parsed;
+            uint8_t* next = spot.board + spot.boardCount;
+            if (parseCardList(lastBracketGroup(line), next, 5 - spot.boardCount, 0, parsed))
+                spot.boardCount += parsed.count;
+            else
+                spot.unsupported = true;
+        }
+        else if (line.compare(4, 9, "SHOW DOWN") == 0 || line.compare(4, 7, "SUMMARY") == 0) {
+            atShowdown = true;
+        }
+        return;
+    }
+
+    if (!atShowdown && line.find("all-in") != string_view::npos) {
+        spot.boardAtAllIn = spot.boardCount;
+        return;
+    }
+
+    size_t shows = line.find(SHOWS_MARKER);
+    if (atShowdown && shows != string_view::npos) {
+        uint8_t indices[2];
+        CardParseResult parsed;
+        if (!parseCardList(lastBracketGroup(line), indices, 2, 0, parsed) || parsed.count != 2) {
+            spot.unsupported = true;
+        }
+        else if (spot.shown < 2) {
+            spot.names[spot.shown] = line.substr(0, shows);
+            spot.holeCards[spot.shown] = parsed.mask;
+        }
+        spot.shown++;
+    }
+}
+
+// Function to append a field to a CSV line, quoting it when needed
+void appendCsvField(string& out, string_view field) {
+    if (field.find_first_of(",\"") == string_view::npos) {
+        out.append(field.data(), field.size());
+        return;
+    }
+    out += '"';
+    for (char ch : field) {
+        if (ch == '"') out += '"';
+        out += ch;
+    }
+    out += '"';
+}
+
+// Function to append cards as a space-separated list ("Ah Kd")
+void appendCards(string& out, const vector<Card>& cards) {
+    for (size_t i = 0; i < cards.size(); ++i) {
+        if (i > 0) out += ' ';
+        out += cardToString(cards[i]);
+    }
+}
+
+void appendNumber(string& out, double value) {
+    char buffer[64];
+    out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value, chars_format::fixed, 2).ptr - buffer);
+}
+
+// Function to compute and append the annotation of a finished hand; returns
+// false if the hand had an all-in that cannot be annotated
+bool annotateHand(const AllInSpot& spot, const AnnotateSettings& settings, string& out) {
+    if (spot.shown != 2 || spot.unsupported || spot.boardAtAllIn == 1 || spot.boardAtAllIn == 2) return false;
+    uint64_t board = 0;
+    for (int c = 0; c < spot.boardAtAllIn; ++c) board |= uint64_t(1) << spot.board[c];
+    uint64_t p1 = spot.holeCards[0], p2 = spot.holeCards[1];
+    if ((p1 & p2) || ((p1 | p2) & board)) return false;
+
+    long long p1Wins = 0, p2Wins = 0, ties = 0, samples = 0;
+    bool exact = spot.boardAtAllIn > 0;
+    if (exact) {
+        ExactEquity result = enumerateEquityExact(board, p1, p2);
+        p1Wins = result.p1Wins;
+        p2Wins = result.p2Wins;
+        ties = result.ties;
+        samples = result.boards;
+    }
+    else {
+        Simulator simulator(cardsFromMask(p1), cardsFromMask(p2), "preflop", {});
+        int wins1 = 0, wins2 = 0, tied = 0;
+        simulator.runTrials(EVAL_SEVEN, settings.preflopTrials, wins1, wins2, tied);
+        p1Wins = wins1;
+        p2Wins = wins2;
+        ties = tied;
+        samples = settings.preflopTrials;
+    }
+
+    static const char* const streetNames[6] = { "preflop", "", "", "flop", "turn", "river" };
+    appendCsvField(out, spot.handID);
+    out += ',';
+    out += streetNames[spot.boardAtAllIn];
+    for (int p = 0; p < 2; ++p) {
+        out += ',';
+        appendCsvField(out, spot.names[p]);
+        out += ',';
+        appendCards(out, cardsFromMask(spot.holeCards[p]));
+    }
+    out += ',';
+    vector<Card> boardCards;
+    for (int c = 0; c < spot.boardAtAllIn; ++c) boardCards.push_back(cardFromIndex(spot.board[c]));
+    appendCards(out, boardCards);
+    // Equity counts half of each tie, so the two columns add up to 100
+    double total = static_cast<double>(max(samples, 1LL));
+    out += ',';
+    appendNumber(out, (p1Wins + ties * 0.5) / total * 100.0);
+    out += ',';
+    appendNumber(out, (p2Wins + ties * 0.5) / total * 100.0);
+    out += ',';
+    appendNumber(out, ties / total * 100.0);
+    out += exact ? ",exact," : ",monte-carlo,";
+    char buffer[32];
+    out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), samples).ptr - buffer);
+    out += '\n';
+    return true;
+}
+
+// Function to annotate every hand of a chunk
+void annotateChunk(string_view text, const AnnotateSettings& settings, AnnotatedChunk& chunk) {
+    AllInSpot spot;
+    bool inHand = false, atShowdown = false;
+    auto finishHand = [&] {
+        if (!inHand) return;
+        chunk.hands++;
+        // Only all-ins that were called down to a showdown have an equity to report
+        if (spot.boardAtAllIn >= 0 && (spot.shown >= 2 || spot.unsupported)) {
+            if (annotateHand(spot, settings, chunk.output)) chunk.annotated++;
+            else chunk.skipped++;
+        }
+        spot = AllInSpot();
+        inHand = atShowdown = false;
+        };
+
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.find_first_not_of(" \t") == string_view::npos) {
+            finishHand();
+            continue;
+        }
+        inHand = true;
+        scanHandLine(line, spot, atShowdown);
+    }
+    finishHand();
+}
+
+int main(int argc, char* argv[]) {
+    cout << "=== Poker Hand-History Annotator ===\n\n";
+
+    string inputPath;
+    string outputPath;
+    int numThreads = static_cast<int>(thread::hardware_concurrency());
+    size_t chunkBytes = size_t(4) << 20;
+    AnnotateSettings settings;
+
+    // Command line options
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) numThreads = atoi(argv[++i]);
+        else if (arg == "--trials" && i + 1 < argc) settings.preflopTrials = atoi(argv[++i]);
+        else if (arg == "--chunk-kb" && i + 1 < argc) chunkBytes = static_cast<size_t>(atol(argv[++i])) * 1024;
+        else if (!arg.empty() && arg[0] != '-' && inputPath.empty()) inputPath = arg;
+        else {
+            inputPath.clear();
+            break;
+        }
+    }
+    if (inputPath.empty() || outputPath.empty()) {
+        cerr << "Usage: " << argv[0] << " --output path [--threads N] [--trials N] [--chunk-kb N] history.txt" << endl;
+        return 1;
+    }
+    if (numThreads <= 0) numThreads = 1;
+    if (settings.preflopTrials <= 0) settings.preflopTrials = 100000;
+    if (chunkBytes == 0) chunkBytes = size_t(4) << 20;
+
+    // Map the whole log; pages are read in on demand, front to back
+    int fd = open(inputPath.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        cerr << "Failed to open " << inputPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    size_t fileSize = static_cast<size_t>(info.st_size);
+    const char* mapped = nullptr;
+    if (fileSize > 0) {
+        void* memory = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory == MAP_FAILED) {
+            cerr << "Failed to map " << inputPath << ": " << strerror(errno) << endl;
+            close(fd);
+            return 1;
+        }
+        madvise(memory, fileSize, MADV_SEQUENTIAL);
+        mapped = static_cast<const char*>(memory);
+    }
+    close(fd);
+    string_view text(mapped, fileSize);
+
+    FILE* output = fopen(outputPath.c_str(), "wb");
+    if (!output) {
+        cerr << "Failed to open " << outputPath << " for writing." << endl;
+        return 1;
+    }
+    bool writeFailed = false;
+    auto write = [&](const string& data) {
+        if (!data.empty() && fwrite(data.data(), 1, data.size(), output) != data.size()) writeFailed = true;
+        };
+    write("HandID,AllInStreet,Player1,Player1Hand,Player2,Player2Hand,CommunityCards,P1Equity,P2Equity,Tie,Method,Samples\n");
+
+    // Workers claim chunks in file order. A worker may run at most a few
+    // chunks ahead of the writer, which bounds the memory held for reordering.
+    const long long chunkCount = static_cast<long long>((fileSize + chunkBytes - 1) / chunkBytes);
+    const long long maxAhead = static_cast<long long>(numThreads) * 4;
+    atomic<long long> nextChunk{ 0 };
+    atomic<long long> written{ 0 };
+    BoundedQueue<AnnotatedChunk*> doneQueue(static_cast<size_t>(maxAhead), numThreads);
+    auto start = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; ++t) {
+        workers.emplace_back([&] {
+            while (true) {
+                long long index = nextChunk++;
+                if (index >= chunkCount) break;
+                for (int round = 0; index >= written + maxAhead; ++round) pipelineBackoff(round);
+                size_t begin = handBoundary(text, static_cast<size_t>(index) * chunkBytes);
+                size_t end = handBoundary(text, min(fileSize, static_cast<size_t>(index + 1) * chunkBytes));
+                auto chunk = new AnnotatedChunk();
+                chunk->sequence = index;
+                if (begin < end) annotateChunk(text.substr(begin, end - begin), settings, *chunk);
+                doneQueue.push(chunk);
+            }
+            doneQueue.producerDone();
+            });
+    }
+
+    // Writer (this thread): chunks finish out of order and are written in file order
+    map<long long, unique_ptr<AnnotatedChunk>> reorder;
+    long long hands = 0, annotated = 0, skipped = 0;
+    AnnotatedChunk* done;
+    long long waited;
+    auto lastReport = chrono::steady_clock::now();
+    while (doneQueue.pop(done, waited)) {
+        reorder[done->sequence].reset(done);
+        while (!reorder.empty() && reorder.begin()->first == written) {
+            const AnnotatedChunk& chunk = *reorder.begin()->second;
+            write(chunk.output);
+            hands += chunk.hands;
+            annotated += chunk.annotated;
+            skipped += chunk.skipped;
+            reorder.erase(reorder.begin());
+            written++;
+        }
+        if (chrono::steady_clock::now() - lastReport > chrono::seconds(5)) {
+            lastReport = chrono::steady_clock::now();
+            cout << "  " << hands << " hands read, " << annotated << " all-ins annotated..." << endl;
+        }
+    }
+    for (auto& worker : workers) worker.join();
+    if (mapped) munmap(const_cast<char*>(mapped), fileSize);
+    if (fclose(output) != 0) writeFailed = true;
+    if (writeFailed) {
+        cerr << "Failed to write " << outputPath << endl;
+        return 1;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << fixed << setprecision(2);
+    cout << "Throughput: " << hands / max(seconds, 1e-9) << " hands/s (" << hands << " hands, "
+        << fileSize / 1048576.0 / max(seconds, 1e-9) << " MB/s, " << seconds << " s on " << numThreads << " threads).\n";
+    cout << "Annotated " << annotated << " heads-up all-ins";
+    if (skipped > 0) cout << "; skipped " << skipped << " all-ins that were multiway or had unreadable cards";
+    cout << ".\n";
+    cout << "Results saved to '" << outputPath << "'.\n";
+    return 0;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using namespace std;
+
+// Functions to count hardware events for the calling thread through perf_event_open;
+// events the machine cannot provide are reported as unavailable.
+
+// Enumeration for the profiled hardware events
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_EVENT_COUNT };
+
+// Column and console names of the events
+inline const char* const PERF_EVENT_NAMES[PERF_EVENT_COUNT] = {
+    "Cycles", "Instructions", "L1DMisses", "LLCMisses", "BranchMisses"
+};
+
+// Structure to hold one reading (or the difference of two) of every event
+struct PerfSample {
+    long long counts[PERF_EVENT_COUNT] = {};
+    bool available[PERF_EVENT_COUNT] = {};
+
+    PerfSample operator-(const PerfSample& start) const {
+        PerfSample delta;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            delta.available[e] = available[e] && start.available[e];
+            delta.counts[e] = delta.available[e] ? counts[e] - start.counts[e] : 0;
+        }
+        return delta;
+    }
+};
+
+// PerfCounters class to count the events of the thread that opened it
+class PerfCounters {
+private:
+    int fds[PERF_EVENT_COUNT];
+
+public:
+    PerfCounters() {
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+            fds[e] = openEvent(static_cast<PerfEvent>(e));
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Function to check whether any event could be opened
+    bool anyAvailable() const {
+        for (int fd : fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    // Function to read the running totals; take the difference of two reads
+    // around the code being measured. Counts are scaled up when the kernel
+    // had to multiplex the events.
+    PerfSample read() const {
+        PerfSample sample;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            uint64_t values[3]; // value, time enabled, time running
+            if (fds[e] < 0 || ::read(fds[e], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)))
+                continue;
+            double scale = values[2] > 0 ? static_cast<double>(values[1]) / values[2] : 1.0;
+            sample.counts[e] = static_cast<long long>(values[0] * scale);
+            sample.available[e] = true;
+        }
+        return sample;
+    }
+
+    // Function to get the counters of the calling thread, opened on first use
+    static PerfCounters& forThisThread() {
+        static thread_local PerfCounters counters;
+        return counters;
+    }
+
+private:
+    static int openEvent(PerfEvent event) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        switch (event) {
+        case PERF_CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        default:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+        // This thread only, on whichever CPU it runs
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+};
+
+// Function to format one event per trial for the console, "n/a" when missing
+inline string perfPerTrial(const PerfSample& sample, int event, long long trials) {
+    if (!sample.available[event] || trials <= 0)
+        return "n/a";
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f", sample.counts[event] / static_cast<double>(trials));
+    return text;
+}
+
+// Function to print the per-trial counts and IPC of a profiled run
+inline void printPerfProfile(const PerfSample& sample, long long trials) {
+    if (!sample.available[PERF_CYCLES] && !sample.available[PERF_INSTRUCTIONS] && !sample.available[PERF_BRANCH_MISSES]) {
+        cout << "Hardware counters: unavailable (check perf_event_paranoid)\n";
+        return;
+    }
+    for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+        cout << PERF_EVENT_NAMES[e] << " per trial: " << perfPerTrial(sample, e, trials) << "\n";
+    if (sample.available[PERF_CYCLES] && sample.available[PERF_INSTRUCTIONS] && sample.counts[PERF_CYCLES] > 0) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.2f", sample.counts[PERF_INSTRUCTIONS] / static_cast<double>(sample.counts[PERF_CYCLES]));
+        cout << "Instructions per cycle: " << text << "\n";
+    }
+}
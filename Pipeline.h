@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+// Lock-free bounded queues and back-off for connecting pipeline stages.
+
+// Function to back off while waiting on a queue; round counts the attempts so far
+inline void pipelineBackoff(int round) {
+    if (round < 16) return;
+    if (round < 64) this_thread::yield();
+    else this_thread::sleep_for(chrono::microseconds(50));
+}
+
+// Bounded lock-free MPMC queue; the capacity is rounded up to a power of two
+template<typename T>
+class BoundedQueue {
+private:
+    struct alignas(64) Cell {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) atomic<size_t> enqueuePos{ 0 };
+    alignas(64) atomic<size_t> dequeuePos{ 0 };
+    alignas(64) atomic<int> producers;
+
+public:
+    // producerCount producers must each call producerDone once they finish
+    BoundedQueue(size_t capacity, int producerCount) : producers(producerCount) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    // Function to get the number of queued items (approximate while in use)
+    size_t size() const {
+        size_t tail = enqueuePos.load(memory_order_relaxed);
+        size_t head = dequeuePos.load(memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool tryPush(const T& value) {
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Full
+            }
+            else {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        size_t pos = dequeuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.sequence.store(pos + mask + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Empty
+            }
+            else {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Function to push, waiting while the queue is full; returns the nanoseconds waited
+    long long push(const T& value) {
+        if (tryPush(value)) return 0;
+        auto start = chrono::steady_clock::now();
+        for (int round = 0; !tryPush(value); ++round) pipelineBackoff(round);
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Function to pop, waiting while the queue is empty; returns false once
+    // every producer is done and the queue is drained
+    bool pop(T& value, long long& waitedNanos) {
+        waitedNanos = 0;
+        if (tryPop(value)) return true;
+        auto start = chrono::steady_clock::now();
+        bool got = false;
+        for (int round = 0;; ++round) {
+            if (tryPop(value)) {
+                got = true;
+                break;
+            }
+            if (producers.load(memory_order_acquire) == 0) {
+                // Recheck: an item may have landed just before the last producer finished
+                got = tryPop(value);
+                break;
+            }
+            pipelineBackoff(round);
+        }
+        waitedNanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        return got;
+    }
+
+    void producerDone() {
+        producers.fetch_sub(1, memory_order_acq_rel);
+    }
+};
+
+// Structure to hold one stage's counters, updated by its threads
+struct StageMetrics {
+    string name;
+    int threads = 1;
+    atomic<long long> items{ 0 };
+    atomic<long long> busyNanos{ 0 };       // Time spent doing the stage's work
+    atomic<long long> inputWaitNanos{ 0 };  // Starved: waiting on an empty input queue
+    atomic<long long> outputWaitNanos{ 0 }; // Blocked: waiting on a full output queue
+
+    // Input queue depth, sampled periodically
+    atomic<long long> depthSamples{ 0 };
+    atomic<long long> depthSum{ 0 };
+    atomic<long long> depthMax{ 0 };
+
+    StageMetrics(const string& stageName, int stageThreads) : name(stageName), threads(stageThreads) {}
+
+    void sampleDepth(long long depth) {
+        depthSamples++;
+        depthSum += depth;
+        long long seen = depthMax.load(memory_order_relaxed);
+        while (depth > seen && !depthMax.compare_exchange_weak(seen, depth)) {}
+    }
+};
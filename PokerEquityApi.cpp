@@ -0,0 +1,217 @@
+#include "PokerEquityApi.h"
+#include "PokerSimulator.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <climits>
+
+// Batched engine behind the C interface: the workers and the calling thread claim
+// spots from each batch in small groups, and batches are served in order.
+
+namespace {
+
+const char* const STAGE_NAMES[] = { "preflop", "flop", "turn", "river" };
+
+// Structure to represent one caller's batch of spots
+struct EquityBatch {
+    const PokerEquitySpot* spots;
+    PokerEquityResult* results;
+    size_t count;
+    size_t grain;
+    size_t next = 0;
+    size_t completed = 0;
+    size_t succeeded = 0;
+    condition_variable done;
+};
+
+// Function to check a spot and build its card vectors
+int32_t decodeSpot(const PokerEquitySpot& spot, vector<Card>& p1Hand, vector<Card>& p2Hand, vector<Card>& commCards) {
+    if (spot.stage < POKER_STAGE_PREFLOP || spot.stage > POKER_STAGE_RIVER)
+        return POKER_EQUITY_BAD_STAGE;
+    if (spot.holeCards != 2 && spot.holeCards != 4)
+        return POKER_EQUITY_BAD_HOLE_CARDS;
+
+    int boardCards = 5 - cardsToDealAt(static_cast<GameStage>(spot.stage));
+    uint64_t used = 0;
+    auto take = [&](const uint8_t* indices, int n, vector<Card>& out) {
+        for (int c = 0; c < n; ++c) {
+            if (indices[c] >= 52)
+                return POKER_EQUITY_BAD_CARD;
+            uint64_t bit = 1ULL << indices[c];
+            if (used & bit)
+                return POKER_EQUITY_DUPLICATE_CARD;
+            used |= bit;
+            out.push_back(cardFromIndex(indices[c]));
+        }
+        return POKER_EQUITY_OK;
+        };
+
+    int32_t status = take(spot.player1, spot.holeCards, p1Hand);
+    if (status == POKER_EQUITY_OK) status = take(spot.player2, spot.holeCards, p2Hand);
+    if (status == POKER_EQUITY_OK) status = take(spot.board, boardCards, commCards);
+    return status;
+}
+
+// Function to evaluate one spot, exactly on the river or when asked to
+void evaluateSpot(const PokerEquitySpot& spot, PokerEquityResult& result, EquityCache* cache) {
+    result = PokerEquityResult();
+    vector<Card> p1Hand, p2Hand, commCards;
+    result.status = decodeSpot(spot, p1Hand, p2Hand, commCards);
+    if (result.status != POKER_EQUITY_OK)
+        return;
+
+    auto startTime = chrono::high_resolution_clock::now();
+    const string stage = STAGE_NAMES[spot.stage];
+    int trials = static_cast<int>(min<int64_t>(spot.trials, INT_MAX));
+    long long boards = 0, execTime = 0;
+    if (spot.holeCards == 4) {
+        OmahaSimulator omaha(p1Hand, p2Hand, stage, commCards);
+        result.exact = trials <= 0 || omaha.neededCommunityCards() == 0;
+        if (result.exact) {
+            omaha.runEnumeration(result.p1Win, result.p2Win, result.tie, boards, execTime);
+        }
+        else {
+            omaha.runSimulation(trials, result.p1Win, result.p2Win, result.tie, execTime);
+            boards = trials;
+        }
+    }
+    else {
+        Simulator simulator(p1Hand, p2Hand, stage, commCards);
+        simulator.setCache(cache);
+        result.exact = trials <= 0 || simulator.neededCommunityCards() == 0;
+        if (result.exact) {
+            simulator.runEnumeration(result.p1Win, result.p2Win, result.tie, boards, execTime);
+        }
+        else {
+            simulator.runSimulation(EVAL_SEVEN, trials, result.p1Win, result.p2Win, result.tie, execTime);
+            boards = trials;
+        }
+    }
+    auto endTime = chrono::high_resolution_clock::now();
+    result.boards = boards;
+    result.execMicros = chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
+}
+
+}
+
+// Engine holding the worker threads, the batch queue and the optional cache
+struct PokerEquityEngine {
+    mutex mtx;
+    condition_variable work;
+    deque<EquityBatch*> batches;
+    bool stopping = false;
+    vector<thread> workers;
+    EquityCache cache;
+
+    explicit PokerEquityEngine(int numWorkers) {
+        for (int i = 0; i < numWorkers; ++i)
+            workers.emplace_back(&PokerEquityEngine::workerLoop, this);
+    }
+
+    ~PokerEquityEngine() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        work.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    // Function to run a batch to completion, helping from the calling thread
+    size_t run(EquityBatch& batch) {
+        unique_lock<mutex> lock(mtx);
+        batches.push_back(&batch);
+        work.notify_all();
+        while (batch.next < batch.count)
+            runGroup(batch, lock);
+        batch.done.wait(lock, [&] { return batch.completed == batch.count; });
+        return batch.succeeded;
+    }
+
+private:
+    void workerLoop() {
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            work.wait(lock, [&] { return stopping || !batches.empty(); });
+            if (batches.empty())
+                return;
+            runGroup(*batches.front(), lock);
+        }
+    }
+
+    // Function to claim and evaluate the next group of spots of a batch. The
+    // lock is held while claiming and released while evaluating; a batch
+    // leaves the queue once every spot is claimed, and is only touched again
+    // to report completion.
+    void runGroup(EquityBatch& batch, unique_lock<mutex>& lock) {
+        size_t first = batch.next;
+        size_t last = min(batch.count, first + batch.grain);
+        batch.next = last;
+        if (last == batch.count)
+            batches.erase(find(batches.begin(), batches.end(), &batch));
+        EquityCache* equityCache = cache.isOpen() ? &cache : nullptr;
+
+        lock.unlock();
+        size_t succeeded = 0;
+        for (size_t i = first; i < last; ++i) {
+            evaluateSpot(batch.spots[i], batch.results[i], equityCache);
+            if (batch.results[i].status == POKER_EQUITY_OK) succeeded++;
+        }
+        lock.lock();
+
+        batch.succeeded += succeeded;
+        batch.completed += last - first;
+        if (batch.completed == batch.count)
+            batch.done.notify_all();
+    }
+};
+
+extern "C" {
+
+int poker_equity_version(void) {
+    return POKER_EQUITY_API_VERSION;
+}
+
+PokerEquityEngine* poker_equity_create(int threads, const char* cachePath) {
+    if (threads <= 0)
+        threads = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    // The calling thread works on its own batches, so it counts as one worker
+    unique_ptr<PokerEquityEngine> engine(new PokerEquityEngine(threads - 1));
+    if (cachePath) {
+        string error;
+        if (!engine->cache.open(cachePath, EquityCache::DEFAULT_SLOTS, error))
+            return nullptr;
+    }
+    return engine.release();
+}
+
+void poker_equity_destroy(PokerEquityEngine* engine) {
+    delete engine;
+}
+
+size_t poker_equity_evaluate(PokerEquityEngine* engine, const PokerEquitySpot* spots, PokerEquityResult* results, size_t count) {
+    if (!engine || !spots || !results || count == 0)
+        return 0;
+    EquityBatch batch;
+    batch.spots = spots;
+    batch.results = results;
+    batch.count = count;
+    // Small groups keep threads balanced when spot costs differ by stage
+    size_t groups = (engine->workers.size() + 1) * 8;
+    batch.grain = max<size_t>(1, min<size_t>(64, count / groups));
+    return engine->run(batch);
+}
+
+const char* poker_equity_status_string(int32_t status) {
+    switch (status) {
+    case POKER_EQUITY_OK: return "ok";
+    case POKER_EQUITY_BAD_STAGE: return "unknown game stage";
+    case POKER_EQUITY_BAD_HOLE_CARDS: return "hole cards must number 2 (Hold'em) or 4 (Omaha)";
+    case POKER_EQUITY_BAD_CARD: return "card index out of range 0-51";
+    case POKER_EQUITY_DUPLICATE_CARD: return "card used more than once";
+    default: return "unknown status";
+    }
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+ * C interface to the equity engine, built as the PokerProj_Equity shared
+ * library. Spots are passed in batches: one call evaluates an array of spots
+ * on the engine's worker threads and fills a parallel array of results.
+ *
+ * Cards are indices 0-51: suit * 13 + (rank - 2), with suits ordered
+ * hearts, diamonds, clubs, spades (so 0 is 2h and 51 is As).
+ *
+ * The structures below are part of the ABI; new fields are only ever added
+ * behind a new POKER_EQUITY_API_VERSION.
+ */
+#ifndef POKER_EQUITY_API_H
+#define POKER_EQUITY_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define POKER_EQUITY_EXPORT __declspec(dllexport)
+#else
+#define POKER_EQUITY_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define POKER_EQUITY_API_VERSION 1
+
+/* Game stages; the stage fixes how many board cards a spot carries (0, 3, 4, 5) */
+enum {
+    POKER_STAGE_PREFLOP = 0,
+    POKER_STAGE_FLOP = 1,
+    POKER_STAGE_TURN = 2,
+    POKER_STAGE_RIVER = 3
+};
+
+/* Result status codes */
+enum {
+    POKER_EQUITY_OK = 0,
+    POKER_EQUITY_BAD_STAGE = 1,
+    POKER_EQUITY_BAD_HOLE_CARDS = 2,
+    POKER_EQUITY_BAD_CARD = 3,
+    POKER_EQUITY_DUPLICATE_CARD = 4
+};
+
+/* One spot to evaluate */
+typedef struct PokerEquitySpot {
+    int32_t stage;         /* POKER_STAGE_* */
+    int32_t holeCards;     /* 2 for Hold'em, 4 for Omaha */
+    uint8_t player1[4];    /* First holeCards entries are used */
+    uint8_t player2[4];
+    uint8_t board[5];      /* First 0/3/4/5 entries are used, by stage */
+    uint8_t reserved[3];
+    int64_t trials;        /* Monte Carlo trials; 0 or less for exact enumeration */
+} PokerEquitySpot;
+
+/* Result for one spot; percentages are 0-100 as in the console programs */
+typedef struct PokerEquityResult {
+    int32_t status;        /* POKER_EQUITY_* */
+    int32_t exact;         /* 1 when the result is an exact enumeration */
+    double p1Win;
+    double p2Win;
+    double tie;
+    int64_t boards;        /* Boards evaluated (trials for Monte Carlo) */
+    int64_t execMicros;    /* Time spent on this spot */
+} PokerEquityResult;
+
+typedef struct PokerEquityEngine PokerEquityEngine;
+
+/* Returns POKER_EQUITY_API_VERSION of the loaded library */
+POKER_EQUITY_EXPORT int poker_equity_version(void);
+
+/*
+ * Creates an engine with the given number of worker threads (0 or less uses
+ * every hardware thread). cachePath may name a persistent equity cache file
+ * shared with PokerProj_Automated and PokerProj_Odds, or be NULL.
+ * Returns NULL if the cache cannot be opened.
+ */
+POKER_EQUITY_EXPORT PokerEquityEngine* poker_equity_create(int threads, const char* cachePath);
+
+POKER_EQUITY_EXPORT void poker_equity_destroy(PokerEquityEngine* engine);
+
+/*
+ * Evaluates count spots, writing results[i] for spots[i]. The calling thread
+ * works on the batch too and returns once every spot is done. Several threads
+ * may call this on one engine at once. Returns the number of spots with
+ * status POKER_EQUITY_OK.
+ */
+POKER_EQUITY_EXPORT size_t poker_equity_evaluate(PokerEquityEngine* engine,
+    const PokerEquitySpot* spots, PokerEquityResult* results, size_t count);
+
+/* Returns a static description of a status code */
+POKER_EQUITY_EXPORT const char* poker_equity_status_string(int32_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
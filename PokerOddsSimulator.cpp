@@ -6,644 +6,846 @@
 #include <unordered_set>
 #include <iomanip>
 #include <sstream>
-#include <map>
-#include <unordered_map>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <list>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "PokerSimulator.h"
+#include "ThreadAffinity.h"
+#include "PerfCounters.h"
 
 using namespace std;
 
-// Enumerations for Suit and Rank
-enum Suit { HEARTS, DIAMONDS, CLUBS, SPADES };
-enum Rank {
-    TWO = 2, THREE, FOUR, FIVE, SIX, SEVEN,
-    EIGHT, NINE, TEN, JACK, QUEEN, KING, ACE
-};
-
-// Structure to represent a Card
-struct Card {
-    Suit suit;
-    Rank rank;
-
-    Card(Suit s, Rank r) : suit(s), rank(r) {}
-
-    // Overload == operator for comparison
-    bool operator==(const Card& other) const {
-        return (suit == other.suit) && (rank == other.rank);
+// Function to get user input for a player's hand
+bool getUserHand(vector<Card>& hand, const string& playerName, unordered_set<string>& usedCards, size_t handSize = 2) {
+    cout << "Enter " << playerName << "'s hand (e.g., " << (handSize == 4 ? "As Ks Qd Jd" : "As Ks") << "): ";
+    string inputLine;
+    getline(cin, inputLine);
+    stringstream ss(inputLine);
+    string cardStr;
+    while (ss >> cardStr) {
+        Card card(HEARTS, TWO); // Dummy initialization
+        if (!parseCard(cardStr, card)) {
+            cout << "Invalid card format: " << cardStr << endl;
+            return false;
+        }
+        string cardKey = cardToString(card);
+        if (usedCards.find(cardKey) != usedCards.end()) {
+            cout << "Duplicate card detected: " << cardKey << endl;
+            return false;
+        }
+        usedCards.insert(cardKey);
+        hand.push_back(card);
     }
-};
+    if (hand.size() != handSize) {
+        cout << "Invalid number of cards for " << playerName << ". Exactly " << handSize << " cards required." << endl;
+        return false;
+    }
+    return true;
+}
 
-// Function to convert card string to Card object
-bool parseCard(const string& cardStr, Card& card) {
-    if (cardStr.length() < 2 || cardStr.length() > 3)
+// Function to get game stage and community cards
+bool getGameStage(string& stage, vector<Card>& communityCards, unordered_set<string>& usedCards) {
+    cout << "Enter game stage (preflop, flop, turn, river): ";
+    cin >> stage;
+    // Validate stage
+    if (stage != "preflop" && stage != "flop" && stage != "turn" && stage != "river") {
+        cout << "Invalid game stage entered." << endl;
         return false;
+    }
+    // Determine number of community cards based on stage
+    int numCommunity = 0;
+    if (stage == "preflop") numCommunity = 0;
+    else if (stage == "flop") numCommunity = 3;
+    else if (stage == "turn") numCommunity = 4;
+    else if (stage == "river") numCommunity = 5;
 
-    // Parse rank
-    string rankStr = "";
-    if (cardStr.length() == 3) { // e.g., "10s"
-        rankStr = cardStr.substr(0, 2);
+    if (numCommunity > 0) {
+        cout << "Enter community cards (space-separated, e.g., 2d 5h 9s): ";
+        cin.ignore(); // Clear newline character from buffer
+        string inputLine;
+        getline(cin, inputLine);
+        stringstream ss(inputLine);
+        string cardStr;
+        while (ss >> cardStr) {
+            Card card(HEARTS, TWO); // Dummy initialization
+            if (!parseCard(cardStr, card)) {
+                cout << "Invalid card format: " << cardStr << endl;
+                return false;
+            }
+            string cardKey = cardToString(card);
+            if (usedCards.find(cardKey) != usedCards.end()) {
+                cout << "Duplicate card detected: " << cardKey << endl;
+                return false;
+            }
+            usedCards.insert(cardKey);
+            communityCards.push_back(card);
+        }
+        if (communityCards.size() != numCommunity) {
+            cout << "Invalid number of community cards for " << stage << ". Expected " << numCommunity << " cards." << endl;
+            return false;
+        }
     }
-    else {
-        rankStr = cardStr.substr(0, 1);
-    }
-
-    // Parse suit
-    char suitChar = cardStr.back();
-
-    // Determine rank
-    Rank rank;
-    if (rankStr == "2") rank = TWO;
-    else if (rankStr == "3") rank = THREE;
-    else if (rankStr == "4") rank = FOUR;
-    else if (rankStr == "5") rank = FIVE;
-    else if (rankStr == "6") rank = SIX;
-    else if (rankStr == "7") rank = SEVEN;
-    else if (rankStr == "8") rank = EIGHT;
-    else if (rankStr == "9") rank = NINE;
-    else if (rankStr == "10") rank = TEN;
-    else if (rankStr == "J" || rankStr == "j") rank = JACK;
-    else if (rankStr == "Q" || rankStr == "q") rank = QUEEN;
-    else if (rankStr == "K" || rankStr == "k") rank = KING;
-    else if (rankStr == "A" || rankStr == "a") rank = ACE;
-    else return false;
-
-    // Determine suit
-    Suit suit;
-    switch (toupper(suitChar)) {
-    case 'H': suit = HEARTS; break;
-    case 'D': suit = DIAMONDS; break;
-    case 'C': suit = CLUBS; break;
-    case 'S': suit = SPADES; break;
-    default: return false;
-    }
-
-    card = Card(suit, rank);
     return true;
 }
 
-// Function to convert Card object to string
-string cardToString(const Card& card) {
-    string rankStr;
-    switch (card.rank) {
-    case TWO: rankStr = "2"; break;
-    case THREE: rankStr = "3"; break;
-    case FOUR: rankStr = "4"; break;
-    case FIVE: rankStr = "5"; break;
-    case SIX: rankStr = "6"; break;
-    case SEVEN: rankStr = "7"; break;
-    case EIGHT: rankStr = "8"; break;
-    case NINE: rankStr = "9"; break;
-    case TEN: rankStr = "10"; break;
-    case JACK: rankStr = "J"; break;
-    case QUEEN: rankStr = "Q"; break;
-    case KING: rankStr = "K"; break;
-    case ACE: rankStr = "A"; break;
-    }
-
-    string suitStr;
-    switch (card.suit) {
-    case HEARTS: suitStr = "h"; break;
-    case DIAMONDS: suitStr = "d"; break;
-    case CLUBS: suitStr = "c"; break;
-    case SPADES: suitStr = "s"; break;
-    }
-
-    return rankStr + suitStr;
+// Equity server: answers one request per line on a Unix domain socket, written as
+// "<player 1 cards> | <player 2 cards> | <community cards> | <trials, "exact" or budget>".
+
+// Requests evaluating more boards than this go to the deep lane
+const long long DEEP_REQUEST_BOARDS = 100000;
+
+// Time budgets above this go to the deep lane (about the time of
+// DEEP_REQUEST_BOARDS boards), and budgets above MAX_BUDGET_MICROS are refused
+const long long DEEP_REQUEST_BUDGET_MICROS = 10000;
+const long long MAX_BUDGET_MICROS = 60000000;
+
+// Structure to represent a queued equity request
+struct EquityJob {
+    vector<Card> player1Hand;
+    vector<Card> player2Hand;
+    vector<Card> communityCards;
+    string gameStage;
+    int trials = 0; // 0 means exact enumeration
+    long long budgetMicros = 0; // Time-budgeted query when positive
+    bool omaha = false; // Four hole cards per player
+    int opponents = 0; // Random opponents in place of player 2's hand
+    bool deep = false;
+    chrono::steady_clock::time_point received;
+    promise<string> response;
+};
+
+// Function to count the boards a request will evaluate
+long long estimateBoards(const EquityJob& job) {
+    if (job.opponents > 0) {
+        MultiwaySimulator multiway(job.player1Hand, job.communityCards, job.opponents);
+        return job.trials > 0 ? job.trials : multiway.exactDeals();
+    }
+    int cardsToDeal = 5 - static_cast<int>(job.communityCards.size());
+    if (job.trials > 0 && cardsToDeal > 0)
+        return job.trials;
+    // Exact enumeration: C(remaining deck, cardsToDeal)
+    long long remaining = 52 - static_cast<long long>(job.player1Hand.size() + job.player2Hand.size() + job.communityCards.size());
+    long long boards = 1;
+    for (int c = 0; c < cardsToDeal; ++c)
+        boards = boards * (remaining - c) / (c + 1);
+    return boards;
 }
 
-// Structure to represent evaluated hand value
-struct HandValue {
-    int category; // 1 to 9
-    vector<int> tiebreakers; // For comparing hands within the same category
+// Function to parse one request line into a job
+bool parseEquityRequest(string_view line, EquityJob& job, string& error) {
+    string_view fields[4];
+    size_t fieldStart[4] = { 0, 0, 0, 0 };
+    int numFields = 0;
+    size_t pos = 0;
+    while (numFields < 4) {
+        size_t bar = line.find('|', pos);
+        fieldStart[numFields] = pos;
+        fields[numFields++] = line.substr(pos, bar == string_view::npos ? string_view::npos : bar - pos);
+        if (bar == string_view::npos) break;
+        pos = bar + 1;
+    }
+    if (numFields != 4 || line.find('|', fieldStart[3]) != string_view::npos) {
+        error = "expected 4 '|'-separated fields";
+        return false;
+    }
 
-    bool operator<(const HandValue& other) const {
-        if (category != other.category)
-            return category < other.category;
-        for (size_t i = 0; i < tiebreakers.size(); ++i) {
-            if (i >= other.tiebreakers.size())
+    // "random" or "random N" in place of player 2's cards
+    string_view opponentField = fields[1];
+    while (!opponentField.empty() && CARD_CHARS.space[static_cast<unsigned char>(opponentField.front())]) opponentField.remove_prefix(1);
+    while (!opponentField.empty() && CARD_CHARS.space[static_cast<unsigned char>(opponentField.back())]) opponentField.remove_suffix(1);
+    if (opponentField.substr(0, 6) == "random") {
+        string_view count = opponentField.substr(6);
+        while (!count.empty() && CARD_CHARS.space[static_cast<unsigned char>(count.front())]) count.remove_prefix(1);
+        job.opponents = 1;
+        if (!count.empty()) {
+            auto parsedCount = from_chars(count.data(), count.data() + count.size(), job.opponents);
+            if (parsedCount.ec != errc() || parsedCount.ptr != count.data() + count.size() ||
+                job.opponents < 1 || job.opponents > MultiwaySimulator::MAX_OPPONENTS) {
+                error = "random opponents must number 1 to 9";
                 return false;
-            if (tiebreakers[i] != other.tiebreakers[i])
-                return tiebreakers[i] < other.tiebreakers[i];
+            }
         }
-        return false;
+        fields[1] = string_view();
     }
 
-    bool operator>(const HandValue& other) const {
-        return other < *this;
+    uint64_t usedMask = 0;
+    vector<Card>* targets[3] = { &job.player1Hand, &job.player2Hand, &job.communityCards };
+    for (int f = 0; f < 3; ++f) {
+        uint8_t indices[5];
+        CardParseResult parsed;
+        if (!parseCardList(fields[f], indices, 5, usedMask, parsed)) {
+            error = string(parsed.error) + " at column " + to_string(fieldStart[f] + parsed.errorPos + 1);
+            return false;
+        }
+        usedMask |= parsed.mask;
+        for (int c = 0; c < parsed.count; ++c)
+            targets[f]->push_back(cardFromIndex(indices[c]));
     }
-
-    bool operator==(const HandValue& other) const {
-        return (category == other.category) && (tiebreakers == other.tiebreakers);
+    if (job.opponents > 0 && job.player1Hand.size() != 2) {
+        error = "random opponents need exactly 2 cards for player 1 (Hold'em)";
+        return false;
+    }
+    // Two hole cards each is Hold'em, four each is Omaha
+    if (job.opponents == 0 && (job.player1Hand.size() != job.player2Hand.size() ||
+        (job.player1Hand.size() != 2 && job.player1Hand.size() != 4))) {
+        error = "each player needs exactly 2 cards (Hold'em) or 4 cards (Omaha)";
+        return false;
+    }
+    job.omaha = job.player1Hand.size() == 4;
+    switch (job.communityCards.size()) {
+    case 0: job.gameStage = "preflop"; break;
+    case 3: job.gameStage = "flop"; break;
+    case 4: job.gameStage = "turn"; break;
+    case 5: job.gameStage = "river"; break;
+    default:
+        error = "community cards must number 0, 3, 4 or 5";
+        return false;
     }
-};
 
-// Deck class to manage cards
-class Deck {
-public:
-    vector<Card> cards;
-
-    Deck(const vector<Card>& excludedCards) {
-        // Initialize full deck
-        for (int s = HEARTS; s <= SPADES; ++s) {
-            for (int r = TWO; r <= ACE; ++r) {
-                Card card(static_cast<Suit>(s), static_cast<Rank>(r));
-                // Check if card is excluded
-                bool excluded = false;
-                for (const auto& ec : excludedCards) {
-                    if (card == ec) {
-                        excluded = true;
-                        break;
-                    }
-                }
-                if (!excluded)
-                    cards.push_back(card);
-            }
+    string_view trialsField = fields[3];
+    while (!trialsField.empty() && CARD_CHARS.space[static_cast<unsigned char>(trialsField.front())]) trialsField.remove_prefix(1);
+    while (!trialsField.empty() && CARD_CHARS.space[static_cast<unsigned char>(trialsField.back())]) trialsField.remove_suffix(1);
+    bool millis = trialsField.size() > 2 && trialsField.substr(trialsField.size() - 2) == "ms";
+    bool micros = trialsField.size() > 2 && trialsField.substr(trialsField.size() - 2) == "us";
+    if (trialsField == "exact") {
+        job.trials = 0;
+    }
+    else if (millis || micros) {
+        string_view number = trialsField.substr(0, trialsField.size() - 2);
+        auto parsedBudget = from_chars(number.data(), number.data() + number.size(), job.budgetMicros);
+        if (parsedBudget.ec != errc() || parsedBudget.ptr != number.data() + number.size() || job.budgetMicros <= 0) {
+            error = "budget must be a positive number of ms or us";
+            return false;
+        }
+        if (job.budgetMicros > (millis ? MAX_BUDGET_MICROS / 1000 : MAX_BUDGET_MICROS)) {
+            error = "budget must not exceed " + to_string(MAX_BUDGET_MICROS / 1000) + "ms";
+            return false;
+        }
+        if (millis) job.budgetMicros *= 1000;
+        if (job.omaha || job.opponents > 0) {
+            error = "time budgets are only supported for Hold'em heads-up";
+            return false;
         }
+        // Short budgets are latency-bound and take the cheap lane; long ones
+        // would hold a worker as long as a deep enumeration
+        job.deep = job.budgetMicros > DEEP_REQUEST_BUDGET_MICROS;
+        return true;
     }
-
-    void shuffleDeck() {
-        random_device rd;
-        mt19937 g(rd());
-        shuffle(cards.begin(), cards.end(), g);
+    else {
+        auto parsedTrials = from_chars(trialsField.data(), trialsField.data() + trialsField.size(), job.trials);
+        if (parsedTrials.ec != errc() || parsedTrials.ptr != trialsField.data() + trialsField.size() || job.trials <= 0) {
+            error = "trials must be a positive integer, 'exact' or a budget such as 5ms";
+            return false;
+        }
     }
-};
+    if (job.opponents > 0 && job.trials == 0 &&
+        !MultiwaySimulator(job.player1Hand, job.communityCards, job.opponents).canEnumerate()) {
+        error = "exact answers against random opponents need the turn or river and few enough deals";
+        return false;
+    }
+    job.deep = estimateBoards(job) > DEEP_REQUEST_BOARDS;
+    return true;
+}
+
+// Worker pool shared by all connections. Cheap and deep requests queue in
+// separate bounded lanes, and deep requests may never occupy every worker,
+// so a burst of preflop enumerations cannot starve river lookups. The pool
+// therefore needs at least two workers.
+class EquityWorkerPool {
+private:
+    mutex mtx;
+    condition_variable cv;
+    deque<unique_ptr<EquityJob>> cheapQueue;
+    deque<unique_ptr<EquityJob>> deepQueue;
+    size_t queueCapacity;
+    int maxDeepRunning;
+    int deepRunning = 0;
+    bool stopping = false;
+    vector<thread> workers;
+    EquityCache* cache;
 
-// HandEvaluator class to evaluate poker hands
-class HandEvaluator {
 public:
-    // Map-based hand evaluation
-    HandValue evaluateHandMap(const vector<Card>& hand) {
-        // Use std::map for counting
-        map<int, int> rankCount;
-        map<Suit, int> suitCount;
-        return evaluateHandGeneric(hand, rankCount, suitCount);
+    // Workers are pinned node by node when a topology is given
+    EquityWorkerPool(int numWorkers, size_t capacity, const CpuTopology* pinTopology, EquityCache* equityCache)
+        : queueCapacity(capacity), maxDeepRunning(numWorkers - 1), cache(equityCache) {
+        for (int i = 0; i < numWorkers; ++i)
+            workers.emplace_back(&EquityWorkerPool::workerLoop, this, i, pinTopology);
     }
 
-    // Hash table-based hand evaluation
-    HandValue evaluateHandHash(const vector<Card>& hand) {
-        // Use std::unordered_map for counting
-        unordered_map<int, int> rankCount;
-        unordered_map<Suit, int> suitCount;
-        return evaluateHandGeneric(hand, rankCount, suitCount);
+    ~EquityWorkerPool() {
+        shutdown();
     }
 
-private:
-    template<typename RankMap, typename SuitMap>
-    HandValue evaluateHandGeneric(const vector<Card>& hand, RankMap& rankCount, SuitMap& suitCount) {
-        // Sort the hand by rank descending
-        vector<Card> sortedHand = hand;
-        sort(sortedHand.begin(), sortedHand.end(), [&](const Card& a, const Card& b) {
-            return a.rank > b.rank;
-            });
-
-        vector<int> ranks;
-        for (const auto& card : sortedHand) {
-            rankCount[card.rank]++;
-            suitCount[card.suit]++;
-            ranks.push_back(card.rank);
+    // Function to enqueue a job; returns false when its lane is full
+    bool submit(unique_ptr<EquityJob>& job) {
+        {
+            lock_guard<mutex> lock(mtx);
+            deque<unique_ptr<EquityJob>>& lane = job->deep ? deepQueue : cheapQueue;
+            if (stopping || lane.size() >= queueCapacity)
+                return false;
+            lane.push_back(move(job));
         }
+        cv.notify_all();
+        return true;
+    }
 
-        bool isFlush = false;
-        Suit flushSuit;
-        for (const auto& sc : suitCount) {
-            if (sc.second >= 5) {
-                isFlush = true;
-                flushSuit = sc.first;
-                break;
-            }
+    void shutdown() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
         }
+    }
 
-        // Extract ranks for straight
-        vector<int> uniqueRanks;
-        for (const auto& rc : rankCount) {
-            uniqueRanks.push_back(rc.first);
-        }
-        sort(uniqueRanks.begin(), uniqueRanks.end(), greater<int>());
-
-        // Check for straight (including Ace-low)
-        bool isStraight = false;
-        int highStraight = 0;
-        if (uniqueRanks.size() >= 5) {
-            for (size_t i = 0; i <= uniqueRanks.size() - 5; ++i) {
-                bool consecutive = true;
-                for (size_t j = 0; j < 4; ++j) {
-                    if (uniqueRanks[i + j] - 1 != uniqueRanks[i + j + 1]) {
-                        consecutive = false;
-                        break;
-                    }
+private:
+    void workerLoop(int index, const CpuTopology* pinTopology) {
+        if (pinTopology && !pinCurrentThread(*pinTopology, index))
+            cerr << "Failed to pin worker " << index << endl;
+        while (true) {
+            unique_ptr<EquityJob> job;
+            {
+                unique_lock<mutex> lock(mtx);
+                cv.wait(lock, [&] {
+                    return stopping || !cheapQueue.empty() ||
+                        (!deepQueue.empty() && deepRunning < maxDeepRunning);
+                    });
+                if (!cheapQueue.empty()) {
+                    job = move(cheapQueue.front());
+                    cheapQueue.pop_front();
                 }
-                if (consecutive) {
-                    isStraight = true;
-                    highStraight = uniqueRanks[i];
-                    break;
+                else if (!deepQueue.empty() && deepRunning < maxDeepRunning) {
+                    job = move(deepQueue.front());
+                    deepQueue.pop_front();
+                    deepRunning++;
                 }
-            }
-            // Check for Ace-low straight
-            if (!isStraight) {
-                // A, 2, 3, 4, 5
-                if (find(uniqueRanks.begin(), uniqueRanks.end(), ACE) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), TWO) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), THREE) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), FOUR) != uniqueRanks.end() &&
-                    find(uniqueRanks.begin(), uniqueRanks.end(), FIVE) != uniqueRanks.end()) {
-                    isStraight = true;
-                    highStraight = FIVE;
+                else {
+                    return; // Stopping with nothing left to run
                 }
             }
-        }
 
-        // Check for straight flush
-        bool isStraightFlush = false;
-        int highStraightFlush = 0;
-        if (isFlush) {
-            // Extract cards of the flush suit
-            vector<Card> flushCards;
-            for (const auto& card : sortedHand) {
-                if (card.suit == flushSuit)
-                    flushCards.push_back(card);
-            }
-            // Check for straight in flushCards
-            vector<int> flushRanks;
-            unordered_map<int, int> flushRankCount;
-            for (const auto& card : flushCards) {
-                flushRankCount[card.rank]++;
-                flushRanks.push_back(card.rank);
-            }
-            sort(flushRanks.begin(), flushRanks.end(), greater<int>());
-            // Remove duplicates
-            flushRanks.erase(unique(flushRanks.begin(), flushRanks.end()), flushRanks.end());
-
-            if (flushRanks.size() >= 5) {
-                for (size_t i = 0; i <= flushRanks.size() - 5; ++i) {
-                    bool consecutive = true;
-                    for (size_t j = 0; j < 4; ++j) {
-                        if (flushRanks[i + j] - 1 != flushRanks[i + j + 1]) {
-                            consecutive = false;
-                            break;
-                        }
-                    }
-                    if (consecutive) {
-                        isStraightFlush = true;
-                        highStraightFlush = flushRanks[i];
-                        break;
-                    }
-                }
-                // Check for Ace-low straight flush
-                if (!isStraightFlush) {
-                    if (find(flushRanks.begin(), flushRanks.end(), ACE) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), TWO) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), THREE) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), FOUR) != flushRanks.end() &&
-                        find(flushRanks.begin(), flushRanks.end(), FIVE) != flushRanks.end()) {
-                        isStraightFlush = true;
-                        highStraightFlush = FIVE;
-                    }
+            job->response.set_value(process(*job, cache));
+
+            if (job->deep) {
+                {
+                    lock_guard<mutex> lock(mtx);
+                    deepRunning--;
                 }
+                cv.notify_all();
             }
         }
+    }
 
-        // Determine hand category and tiebreakers
-        HandValue hv;
-        if (isStraightFlush) {
-            hv.category = 9; // Straight Flush
-            hv.tiebreakers.push_back(highStraightFlush);
+    static string process(EquityJob& job, EquityCache* cache) {
+        Simulator simulator(job.player1Hand, job.player2Hand, job.gameStage, job.communityCards);
+        simulator.setCache(cache);
+        double p1Win = 0.0, p2Win = 0.0, tie = 0.0;
+        long long boards = 0, execTime = 0;
+        // The river has a single runout, so it is always answered exactly
+        if (job.budgetMicros > 0) {
+            BudgetedEquity budgeted;
+            simulator.runBudgeted(chrono::microseconds(job.budgetMicros), budgeted);
+            auto latency = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - job.received).count();
+            stringstream ss;
+            ss << fixed << setprecision(4);
+            ss << "OK " << budgeted.p1Win << " " << budgeted.p2Win << " " << budgeted.tie << " " << budgeted.trials
+                << " " << latency << " " << budgeted.standardError << "\n";
+            return ss.str();
         }
-        else {
-            // Check for Four of a Kind
-            bool fourKind = false;
-            int fourRank = 0;
-            for (const auto& rc : rankCount) {
-                if (rc.second == 4) {
-                    fourKind = true;
-                    fourRank = rc.first;
-                    break;
-                }
-            }
-            if (fourKind) {
-                hv.category = 8; // Four of a Kind
-                hv.tiebreakers.push_back(fourRank);
-                // Add highest kicker
-                for (const auto& card : sortedHand) {
-                    if (card.rank != fourRank) {
-                        hv.tiebreakers.push_back(card.rank);
-                        break;
-                    }
-                }
+        if (job.opponents > 0) {
+            MultiwaySimulator multiway(job.player1Hand, job.communityCards, job.opponents);
+            MultiwayEquity result;
+            if (job.trials == 0 || (multiway.neededCommunityCards() == 0 && multiway.canEnumerate()))
+                multiway.runEnumeration(result, execTime);
+            else
+                multiway.runSimulation(job.trials, result, execTime);
+            auto latency = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - job.received).count();
+            stringstream ss;
+            ss << fixed << setprecision(4);
+            ss << "OK " << result.win << " " << result.lose << " " << result.tie << " " << result.samples
+                << " " << latency << " " << result.equity << "\n";
+            return ss.str();
+        }
+        if (job.omaha) {
+            OmahaSimulator omaha(job.player1Hand, job.player2Hand, job.gameStage, job.communityCards);
+            if (job.trials == 0 || omaha.neededCommunityCards() == 0) {
+                omaha.runEnumeration(p1Win, p2Win, tie, boards, execTime);
             }
             else {
-                // Check for Full House
-                bool threeKind = false;
-                int threeRank = 0;
-                vector<int> pairs;
-                for (const auto& rc : rankCount) {
-                    if (rc.second == 3) {
-                        if (!threeKind || rc.first > threeRank) {
-                            threeKind = true;
-                            threeRank = rc.first;
-                        }
-                    }
-                    else if (rc.second == 2) {
-                        pairs.push_back(rc.first);
-                    }
-                }
-                if (threeKind && (pairs.size() >= 1 || (threeRank && rankCount.size() >= 2))) {
-                    hv.category = 7; // Full House
-                    hv.tiebreakers.push_back(threeRank);
-                    // Find the highest pair
-                    int highestPair = 0;
-                    for (const auto& pr : pairs) {
-                        if (pr > highestPair) highestPair = pr;
-                    }
-                    // If no pairs, find second three of a kind
-                    if (highestPair == 0) {
-                        for (const auto& rc : rankCount) {
-                            if (rc.second == 3 && rc.first != threeRank) {
-                                if (rc.first > highestPair) highestPair = rc.first;
-                            }
-                        }
-                    }
-                    hv.tiebreakers.push_back(highestPair);
-                }
-                else {
-                    // Check for Flush
-                    if (isFlush) {
-                        hv.category = 6; // Flush
-                        // Add top five cards of flush
-                        int count = 0;
-                        for (const auto& card : sortedHand) {
-                            if (card.suit == flushSuit) {
-                                hv.tiebreakers.push_back(card.rank);
-                                count++;
-                                if (count == 5) break;
-                            }
-                        }
-                    }
-                    else {
-                        // Check for Straight
-                        if (isStraight) {
-                            hv.category = 5; // Straight
-                            hv.tiebreakers.push_back(highStraight);
-                        }
-                        else {
-                            // Check for Three of a Kind
-                            if (threeKind) {
-                                hv.category = 4; // Three of a Kind
-                                hv.tiebreakers.push_back(threeRank);
-                                // Add two highest kickers
-                                int kickers = 0;
-                                for (const auto& card : sortedHand) {
-                                    if (card.rank != threeRank) {
-                                        hv.tiebreakers.push_back(card.rank);
-                                        kickers++;
-                                        if (kickers == 2) break;
-                                    }
-                                }
-                            }
-                            else {
-                                // Check for Two Pair
-                                vector<int> pairsFound;
-                                for (const auto& rc : rankCount) {
-                                    if (rc.second == 2) {
-                                        pairsFound.push_back(rc.first);
-                                    }
-                                }
-                                if (pairsFound.size() >= 2) {
-                                    hv.category = 3; // Two Pair
-                                    sort(pairsFound.begin(), pairsFound.end(), greater<int>());
-                                    hv.tiebreakers.push_back(pairsFound[0]);
-                                    hv.tiebreakers.push_back(pairsFound[1]);
-                                    // Add highest kicker
-                                    for (const auto& card : sortedHand) {
-                                        if (card.rank != pairsFound[0] && card.rank != pairsFound[1]) {
-                                            hv.tiebreakers.push_back(card.rank);
-                                            break;
-                                        }
-                                    }
-                                }
-                                else {
-                                    // Check for One Pair
-                                    if (pairsFound.size() == 1) {
-                                        hv.category = 2; // One Pair
-                                        hv.tiebreakers.push_back(pairsFound[0]);
-                                        // Add three highest kickers
-                                        int kickers = 0;
-                                        for (const auto& card : sortedHand) {
-                                            if (card.rank != pairsFound[0]) {
-                                                hv.tiebreakers.push_back(card.rank);
-                                                kickers++;
-                                                if (kickers == 3) break;
-                                            }
-                                        }
-                                    }
-                                    else {
-                                        // High Card
-                                        hv.category = 1; // High Card
-                                        // Add top five cards
-                                        for (int i = 0; i < 5 && i < sortedHand.size(); ++i) {
-                                            hv.tiebreakers.push_back(sortedHand[i].rank);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+                omaha.runSimulation(job.trials, p1Win, p2Win, tie, execTime);
+                boards = job.trials;
             }
         }
+        else if (job.trials == 0 || simulator.neededCommunityCards() == 0) {
+            simulator.runEnumeration(p1Win, p2Win, tie, boards, execTime);
+        }
+        else {
+            simulator.runSimulation(EVAL_SEVEN, job.trials, p1Win, p2Win, tie, execTime);
+            boards = job.trials;
+        }
 
-        return hv;
+        auto latency = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - job.received).count();
+        stringstream ss;
+        ss << fixed << setprecision(4);
+        ss << "OK " << p1Win << " " << p2Win << " " << tie << " " << boards << " " << latency << "\n";
+        return ss.str();
     }
 };
 
-// Simulator class to perform Monte Carlo simulations
-class Simulator {
-private:
-    vector<Card> player1Hand;
-    vector<Card> player2Hand;
-    vector<Card> communityCards;
-    string gameStage;
-    HandEvaluator evaluator;
+volatile sig_atomic_t serverStopRequested = 0;
 
-public:
-    Simulator(const vector<Card>& p1Hand, const vector<Card>& p2Hand, const string& stage, const vector<Card>& commCards)
-        : player1Hand(p1Hand), player2Hand(p2Hand), gameStage(stage), communityCards(commCards) {}
-
-    // Function to get all used cards (players' hands and community cards)
-    vector<Card> getAllUsedCards() const {
-        vector<Card> used = player1Hand;
-        used.insert(used.end(), player2Hand.begin(), player2Hand.end());
-        used.insert(used.end(), communityCards.begin(), communityCards.end());
-        return used;
-    }
-
-    // Function to determine how many community cards are needed based on game stage
-    int neededCommunityCards() const {
-        if (gameStage == "preflop") return 5;
-        else if (gameStage == "flop") return 2;
-        else if (gameStage == "turn") return 1;
-        else if (gameStage == "river") return 0;
-        else return 0;
-    }
-
-    // Function to run map-based simulation
-    void runSimulationMap(int trials, double& p1Win, double& p2Win, double& tie, long long& execTime) {
-        int p1Wins = 0, p2Wins = 0, ties = 0;
-        auto startTime = chrono::high_resolution_clock::now();
-
-        for (int i = 0; i < trials; ++i) {
-            // Initialize deck
-            Deck deck(getAllUsedCards());
-            deck.shuffleDeck();
-
-            // Deal needed community cards
-            vector<Card> simCommunity = communityCards;
-            int cardsToDeal = neededCommunityCards();
-            for (int c = 0; c < cardsToDeal; ++c) {
-                if (deck.cards.empty()) break; // Safety check
-                simCommunity.push_back(deck.cards.back());
-                deck.cards.pop_back();
+void handleServerSignal(int) {
+    serverStopRequested = 1;
+}
+
+// Function to send a whole response, ignoring a peer that went away
+void sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// Function to serve one client connection until it disconnects; the caller
+// owns and closes fd
+void serveConnection(int fd, EquityWorkerPool& pool) {
+    string buffer;
+    char chunk[4096];
+    while (true) {
+        size_t newline;
+        while ((newline = buffer.find('\n')) != string::npos) {
+            string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            auto job = make_unique<EquityJob>();
+            job->received = chrono::steady_clock::now();
+            string error;
+            if (!parseEquityRequest(line, *job, error)) {
+                sendAll(fd, "ERR " + error + "\n");
+                continue;
+            }
+            bool deep = job->deep;
+            future<string> result = job->response.get_future();
+            if (!pool.submit(job)) {
+                sendAll(fd, deep ? "BUSY deep\n" : "BUSY cheap\n");
+                continue;
             }
+            sendAll(fd, result.get());
+        }
+
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+// Structure to represent one client connection and the thread serving it.
+// fd is closed and reset to -1 under the server's connection lock, so the
+// number cannot be reused by accept() while it is still tracked here.
+struct ServerConnection {
+    int fd;
+    thread worker;
+    atomic<bool> done{ false };
+};
+
+// Function to run the equity server until SIGINT/SIGTERM
+int runEquityServer(const string& socketPath, int numWorkers, size_t queueCapacity, bool pinThreads, EquityCache* cache) {
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        cerr << "Failed to create socket: " << strerror(errno) << endl;
+        return 1;
+    }
 
-            // Evaluate hands using map
-            vector<Card> p1Total = player1Hand;
-            p1Total.insert(p1Total.end(), simCommunity.begin(), simCommunity.end());
-            vector<Card> p2Total = player2Hand;
-            p2Total.insert(p2Total.end(), simCommunity.begin(), simCommunity.end());
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        cerr << "Socket path too long: " << socketPath << endl;
+        close(listenFd);
+        return 1;
+    }
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, 64) < 0) {
+        cerr << "Failed to listen on " << socketPath << ": " << strerror(errno) << endl;
+        close(listenFd);
+        return 1;
+    }
 
-            HandValue hv1 = evaluator.evaluateHandMap(p1Total);
-            HandValue hv2 = evaluator.evaluateHandMap(p2Total);
+    struct sigaction sa {};
+    sa.sa_handler = handleServerSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // SIGINT/SIGTERM stay blocked in this thread and in every thread it
+    // starts; ppoll() unblocks them only while the accept loop waits, so the
+    // stop signal always lands here and always interrupts the wait
+    sigset_t stopSignals, previousMask;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &previousMask);
+    sigset_t waitMask = previousMask;
+    sigdelset(&waitMask, SIGINT);
+    sigdelset(&waitMask, SIGTERM);
+
+    cout << "Equity server listening on " << socketPath << " with " << numWorkers
+        << " workers (queue capacity " << queueCapacity << " per lane)\n";
+
+    CpuTopology topology = detectCpuTopology();
+    EquityWorkerPool pool(numWorkers, queueCapacity, pinThreads ? &topology : nullptr, cache);
+    mutex connectionsMtx;
+    list<unique_ptr<ServerConnection>> connections; // Only the accept loop adds or removes entries
+
+    // Function to join the threads of connections that have ended
+    auto reapConnections = [&] {
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (!(*it)->done.load(memory_order_acquire)) {
+                ++it;
+                continue;
+            }
+            (*it)->worker.join();
+            it = connections.erase(it);
+        }
+    };
+
+    while (!serverStopRequested) {
+        // Wake at least once a second to reap finished connections
+        pollfd listenPoll{ listenFd, POLLIN, 0 };
+        timespec reapInterval{ 1, 0 };
+        int ready = ppoll(&listenPoll, 1, &reapInterval, &waitMask);
+        reapConnections();
+        if (ready < 0 && errno != EINTR) {
+            cerr << "poll failed: " << strerror(errno) << endl;
+            break;
+        }
+        if (ready <= 0) continue;
 
-            // Compare hands
-            if (hv1 > hv2) p1Wins++;
-            else if (hv2 > hv1) p2Wins++;
-            else ties++;
+        int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            cerr << "accept failed: " << strerror(errno) << endl;
+            break;
         }
+        auto connection = make_unique<ServerConnection>();
+        ServerConnection* served = connection.get();
+        served->fd = clientFd;
+        served->worker = thread([served, &pool, &connectionsMtx] {
+            serveConnection(served->fd, pool);
+            lock_guard<mutex> lock(connectionsMtx);
+            close(served->fd);
+            served->fd = -1;
+            served->done.store(true, memory_order_release);
+            });
+        connections.push_back(move(connection));
+    }
 
-        auto endTime = chrono::high_resolution_clock::now();
-        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+    cout << "\nShutting down equity server...\n";
+    close(listenFd);
+    unlink(socketPath.c_str());
+    {
+        // Wake connection threads blocked in read()
+        lock_guard<mutex> lock(connectionsMtx);
+        for (auto& connection : connections) {
+            if (connection->fd >= 0) shutdown(connection->fd, SHUT_RDWR);
+        }
+    }
+    for (auto& connection : connections) connection->worker.join();
+    pool.shutdown();
+    pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+    return 0;
+}
 
-        p1Win = (p1Wins / static_cast<double>(trials)) * 100.0;
-        p2Win = (p2Wins / static_cast<double>(trials)) * 100.0;
-        tie = (ties / static_cast<double>(trials)) * 100.0;
+// Function to print every hand's river equity against a random hand, strongest first
+int runRiverRanking(const string& boardText) {
+    uint8_t indices[5];
+    CardParseResult parsed;
+    if (!parseCardList(boardText, indices, 5, 0, parsed) || parsed.count != 5) {
+        cerr << "River ranking needs exactly 5 board cards";
+        if (!parsed.ok()) cerr << ": " << parsed.error << " at column " << parsed.errorPos + 1;
+        cerr << endl;
+        return 1;
     }
+    vector<Card> board;
+    for (int c = 0; c < 5; ++c) board.push_back(cardFromIndex(indices[c]));
+
+    auto startTime = chrono::high_resolution_clock::now();
+    RiverRanking ranking(board);
+    const auto& combos = ranking.ranking();
+    vector<RangeOutcome> outcomes(combos.size());
+    for (size_t i = 0; i < combos.size(); ++i)
+        outcomes[i] = ranking.versusRange(combos[i].first, combos[i].second);
+    auto endTime = chrono::high_resolution_clock::now();
+
+    // Rank 1 is the nuts; tied hands share a rank
+    cout << "Rank,Hand,Wins,Ties,Losses,Equity\n";
+    cout << fixed << setprecision(4);
+    int rank = 0;
+    for (size_t i = combos.size(); i-- > 0;) {
+        if (i + 1 == combos.size() || combos[i].score != combos[i + 1].score)
+            rank++;
+        cout << rank << "," << cardToString(cardFromIndex(combos[i].first)) << " " << cardToString(cardFromIndex(combos[i].second))
+            << "," << outcomes[i].wins << "," << outcomes[i].ties << "," << outcomes[i].losses
+            << "," << outcomes[i].equity() * 100.0 << "\n";
+    }
+    cerr << "Ranked " << combos.size() << " hands in "
+        << chrono::duration_cast<chrono::microseconds>(endTime - startTime).count() << " us" << endl;
+    return 0;
+}
+
+// Progressive mode: workers publish running totals after each batch in slots guarded
+// by a sequence counter, and the main thread reports the pooled estimate.
 
-    // Function to run hash table-based simulation
-    void runSimulationHash(int trials, double& p1Win, double& p2Win, double& tie, long long& execTime) {
-        int p1Wins = 0, p2Wins = 0, ties = 0;
-        auto startTime = chrono::high_resolution_clock::now();
+const int PROGRESSIVE_BATCH_TRIALS = 1000;
+const int PROGRESSIVE_REPORT_MS = 250;
 
-        for (int i = 0; i < trials; ++i) {
-            // Initialize deck
-            Deck deck(getAllUsedCards());
-            deck.shuffleDeck();
+// Structure to hold one worker's published totals
+struct alignas(64) ProgressSlot {
+    atomic<uint64_t> sequence{ 0 };
+    atomic<long long> p1Wins{ 0 };
+    atomic<long long> p2Wins{ 0 };
+    atomic<long long> ties{ 0 };
+    atomic<long long> trials{ 0 };
+};
 
-            // Deal needed community cards
-            vector<Card> simCommunity = communityCards;
-            int cardsToDeal = neededCommunityCards();
-            for (int c = 0; c < cardsToDeal; ++c) {
-                if (deck.cards.empty()) break; // Safety check
-                simCommunity.push_back(deck.cards.back());
-                deck.cards.pop_back();
+// Function to run trials until the confidence interval is narrow enough,
+// maxTrials is reached, or the user presses Enter
+void runProgressive(const vector<Card>& player1Hand, const vector<Card>& player2Hand, const string& gameStage,
+    const vector<Card>& communityCards, double targetInterval, long long maxTrials) {
+    int numWorkers = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    vector<ProgressSlot> slots(numWorkers);
+    atomic<bool> stopRequested{ false };
+
+    vector<thread> workers;
+    for (int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back([&, w] {
+            Simulator simulator(player1Hand, player2Hand, gameStage, communityCards);
+            ProgressSlot& slot = slots[w];
+            long long p1Wins = 0, p2Wins = 0, ties = 0, trials = 0;
+            while (!stopRequested.load(memory_order_relaxed)) {
+                int batchP1 = 0, batchP2 = 0, batchTies = 0;
+                simulator.runTrials(EVAL_SEVEN, PROGRESSIVE_BATCH_TRIALS, batchP1, batchP2, batchTies);
+                p1Wins += batchP1;
+                p2Wins += batchP2;
+                ties += batchTies;
+                trials += PROGRESSIVE_BATCH_TRIALS;
+
+                // Publish: odd sequence while the totals change
+                uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+                slot.sequence.store(sequence + 1, memory_order_relaxed);
+                atomic_thread_fence(memory_order_release);
+                slot.p1Wins.store(p1Wins, memory_order_relaxed);
+                slot.p2Wins.store(p2Wins, memory_order_relaxed);
+                slot.ties.store(ties, memory_order_relaxed);
+                slot.trials.store(trials, memory_order_relaxed);
+                slot.sequence.store(sequence + 2, memory_order_release);
             }
+            });
+    }
 
-            // Evaluate hands using hash tables
-            vector<Card> p1Total = player1Hand;
-            p1Total.insert(p1Total.end(), simCommunity.begin(), simCommunity.end());
-            vector<Card> p2Total = player2Hand;
-            p2Total.insert(p2Total.end(), simCommunity.begin(), simCommunity.end());
+    // Function to sum every worker's latest consistent totals
+    auto collect = [&](long long& p1Wins, long long& p2Wins, long long& ties, long long& trials) {
+        p1Wins = p2Wins = ties = trials = 0;
+        for (auto& slot : slots) {
+            while (true) {
+                uint64_t before = slot.sequence.load(memory_order_acquire);
+                if (before & 1) continue;
+                long long a = slot.p1Wins.load(memory_order_relaxed);
+                long long b = slot.p2Wins.load(memory_order_relaxed);
+                long long c = slot.ties.load(memory_order_relaxed);
+                long long n = slot.trials.load(memory_order_relaxed);
+                atomic_thread_fence(memory_order_acquire);
+                if (slot.sequence.load(memory_order_relaxed) != before) continue;
+                p1Wins += a;
+                p2Wins += b;
+                ties += c;
+                trials += n;
+                break;
+            }
+        }
+        };
+
+    // 95% confidence half-width of a share, in percentage points
+    auto interval = [](long long count, long long trials) {
+        double share = count / static_cast<double>(trials);
+        return 1.96 * sqrt(share * (1.0 - share) / trials) * 100.0;
+        };
 
-            HandValue hv1 = evaluator.evaluateHandHash(p1Total);
-            HandValue hv2 = evaluator.evaluateHandHash(p2Total);
+    cout << "Press Enter to stop early.\n";
+    cout << fixed << setprecision(2);
+    auto startTime = chrono::steady_clock::now();
+    bool stdinOpen = true;
+    long long p1Wins = 0, p2Wins = 0, ties = 0, trials = 0;
+    const char* stopReason = "";
+    while (true) {
+        // Wait for the next report, or for the user to press Enter
+        if (stdinOpen) {
+            pollfd input{ STDIN_FILENO, POLLIN, 0 };
+            if (poll(&input, 1, PROGRESSIVE_REPORT_MS) > 0) {
+                string line;
+                if (getline(cin, line)) {
+                    stopReason = "stopped by user";
+                }
+                else {
+                    stdinOpen = false; // Input closed: keep running to the target
+                }
+            }
+        }
+        else {
+            this_thread::sleep_for(chrono::milliseconds(PROGRESSIVE_REPORT_MS));
+        }
 
-            // Compare hands
-            if (hv1 > hv2) p1Wins++;
-            else if (hv2 > hv1) p2Wins++;
-            else ties++;
+        collect(p1Wins, p2Wins, ties, trials);
+        if (trials == 0) {
+            if (*stopReason) break;
+            continue;
         }
+        double elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count() / 1000.0;
+        double widest = max({ interval(p1Wins, trials), interval(p2Wins, trials), interval(ties, trials) });
+        cout << "[" << setw(6) << elapsed << " s] " << setw(10) << trials << " trials"
+            << "  P1 " << p1Wins * 100.0 / trials << "% +/- " << interval(p1Wins, trials)
+            << "  P2 " << p2Wins * 100.0 / trials << "% +/- " << interval(p2Wins, trials)
+            << "  Tie " << ties * 100.0 / trials << "% +/- " << interval(ties, trials) << "\n" << flush;
+
+        if (!*stopReason && widest <= targetInterval) stopReason = "target confidence interval reached";
+        if (!*stopReason && trials >= maxTrials) stopReason = "trial limit reached";
+        if (*stopReason) break;
+    }
 
-        auto endTime = chrono::high_resolution_clock::now();
-        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+    stopRequested = true;
+    for (auto& worker : workers) worker.join();
+    collect(p1Wins, p2Wins, ties, trials);
+    double elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count() / 1000.0;
 
-        p1Win = (p1Wins / static_cast<double>(trials)) * 100.0;
-        p2Win = (p2Wins / static_cast<double>(trials)) * 100.0;
-        tie = (ties / static_cast<double>(trials)) * 100.0;
+    cout << "\n--- Simulation Results ---\n";
+    cout << "\nProgressive Results (" << stopReason << "):\n";
+    if (trials > 0) {
+        cout << "Player 1 Win %: " << p1Wins * 100.0 / trials << "% +/- " << interval(p1Wins, trials) << "\n";
+        cout << "Player 2 Win %: " << p2Wins * 100.0 / trials << "% +/- " << interval(p2Wins, trials) << "\n";
+        cout << "Tie %: " << ties * 100.0 / trials << "% +/- " << interval(ties, trials) << "\n";
     }
-};
+    cout << "Trials: " << trials << " on " << numWorkers << " threads\n";
+    cout << "Simulation Time: " << static_cast<long long>(elapsed * 1000) << " ms\n";
+}
 
-// Function to get user input for a player's hand
-bool getUserHand(vector<Card>& hand, const string& playerName, unordered_set<string>& usedCards) {
-    cout << "Enter " << playerName << "'s hand (e.g., As Ks): ";
-    string inputLine;
-    getline(cin, inputLine);
-    stringstream ss(inputLine);
-    string cardStr;
-    while (ss >> cardStr) {
-        Card card(HEARTS, TWO); // Dummy initialization
-        if (!parseCard(cardStr, card)) {
-            cout << "Invalid card format: " << cardStr << endl;
-            return false;
-        }
-        string cardKey = cardToString(card);
-        if (usedCards.find(cardKey) != usedCards.end()) {
-            cout << "Duplicate card detected: " << cardKey << endl;
-            return false;
+// Main function
+int main(int argc, char* argv[]) {
+    // --cache path works in every mode; --profile, --progressive and
+    // --backends apply to the interactive Hold'em calculator with a known
+    // Player 2 hand, and --progressive excludes the other two
+    vector<string> cliArgs;
+    string cachePath;
+    bool omaha = false;
+    bool profile = false;
+    bool progressive = false;
+    int opponents = 0; // Random opponents instead of a known Player 2 hand
+    double targetInterval = 0.1;
+    long long maxTrials = 100000000;
+    vector<EvaluatorBackend> backends = { EVAL_MAP, EVAL_HASH };
+    bool backendsGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--cache" && i + 1 < argc) cachePath = argv[++i];
+        else if (string(argv[i]) == "--omaha") omaha = true;
+        else if (string(argv[i]) == "--profile") profile = true;
+        else if (string(argv[i]) == "--progressive") progressive = true;
+        else if (string(argv[i]) == "--opponents" && i + 1 < argc) opponents = atoi(argv[++i]);
+        else if (string(argv[i]) == "--target-ci" && i + 1 < argc) targetInterval = atof(argv[++i]);
+        else if (string(argv[i]) == "--max-trials" && i + 1 < argc) maxTrials = atoll(argv[++i]);
+        else if (string(argv[i]) == "--backends" && i + 1 < argc) {
+            string error;
+            if (!parseEvaluatorBackendList(argv[++i], backends, error)) {
+                cerr << "Invalid --backends: " << error << endl;
+                return 1;
+            }
+            backendsGiven = true;
         }
-        usedCards.insert(cardKey);
-        hand.push_back(card);
+        else cliArgs.push_back(argv[i]);
     }
-    if (hand.size() != 2) {
-        cout << "Invalid number of cards for " << playerName << ". Exactly 2 cards required." << endl;
-        return false;
+    size_t handSize = omaha ? 4 : 2;
+    if (opponents < 0 || opponents > MultiwaySimulator::MAX_OPPONENTS || (opponents > 0 && omaha)) {
+        cerr << "--opponents takes 1 to " << MultiwaySimulator::MAX_OPPONENTS << " random opponents (Hold'em only)" << endl;
+        return 1;
     }
-    return true;
-}
+    if (opponents > 0 && progressive) {
+        cerr << "--progressive needs a known Player 2 hand; it cannot be combined with --opponents" << endl;
+        return 1;
+    }
+    // The Omaha, random-opponent and progressive runs have one fixed engine each
+    if ((profile || backendsGiven) && (omaha || opponents > 0 || progressive)) {
+        cerr << "--profile and --backends cannot be combined with --omaha, --opponents or --progressive" << endl;
+        return 1;
+    }
+    if (progressive && omaha) {
+        cerr << "--progressive is only supported for Hold'em" << endl;
+        return 1;
+    }
+    EquityCache cache;
+    if (!cachePath.empty()) {
+        string error;
+        if (!cache.open(cachePath, EquityCache::DEFAULT_SLOTS, error)) {
+            cerr << "Failed to open equity cache: " << error << endl;
+            return 1;
+        }
+    }
+    EquityCache* cacheForRuns = cache.isOpen() ? &cache : nullptr;
 
-// Function to get game stage and community cards
-bool getGameStage(string& stage, vector<Card>& communityCards, unordered_set<string>& usedCards) {
-    cout << "Enter game stage (preflop, flop, turn, river): ";
-    cin >> stage;
-    // Validate stage
-    if (stage != "preflop" && stage != "flop" && stage != "turn" && stage != "river") {
-        cout << "Invalid game stage entered." << endl;
-        return false;
+    if (!cliArgs.empty() && cliArgs[0] == "--river-ranking") {
+        // The board may be given as one argument or as five
+        string boardText;
+        for (size_t i = 1; i < cliArgs.size(); ++i) boardText += cliArgs[i] + " ";
+        return runRiverRanking(boardText);
     }
-    // Determine number of community cards based on stage
-    int numCommunity = 0;
-    if (stage == "preflop") numCommunity = 0;
-    else if (stage == "flop") numCommunity = 3;
-    else if (stage == "turn") numCommunity = 4;
-    else if (stage == "river") numCommunity = 5;
 
-    if (numCommunity > 0) {
-        cout << "Enter community cards (space-separated, e.g., 2d 5h 9s): ";
-        cin.ignore(); // Clear newline character from buffer
-        string inputLine;
-        getline(cin, inputLine);
-        stringstream ss(inputLine);
-        string cardStr;
-        while (ss >> cardStr) {
-            Card card(HEARTS, TWO); // Dummy initialization
-            if (!parseCard(cardStr, card)) {
-                cout << "Invalid card format: " << cardStr << endl;
-                return false;
-            }
-            string cardKey = cardToString(card);
-            if (usedCards.find(cardKey) != usedCards.end()) {
-                cout << "Duplicate card detected: " << cardKey << endl;
-                return false;
-            }
-            usedCards.insert(cardKey);
-            communityCards.push_back(card);
+    if (!cliArgs.empty() && cliArgs[0] == "--serve") {
+        // Positional arguments, plus an optional --pin-threads flag
+        vector<string> args;
+        bool pinThreads = false;
+        for (size_t i = 1; i < cliArgs.size(); ++i) {
+            if (cliArgs[i] == "--pin-threads") pinThreads = true;
+            else args.push_back(cliArgs[i]);
         }
-        if (communityCards.size() != numCommunity) {
-            cout << "Invalid number of community cards for " << stage << ". Expected " << numCommunity << " cards." << endl;
-            return false;
+        string socketPath = args.size() > 0 ? args[0] : "/tmp/pokerproj_odds.sock";
+        // Deep requests may use all workers but one, so isolating the cheap
+        // lane needs at least two
+        int numWorkers = args.size() > 1 ? atoi(args[1].c_str()) : static_cast<int>(max(2u, thread::hardware_concurrency()));
+        int queueCapacity = args.size() > 2 ? atoi(args[2].c_str()) : 64;
+        if (numWorkers < 2) {
+            cerr << "The equity server needs at least 2 workers" << endl;
+            return 1;
         }
+        if (queueCapacity <= 0) queueCapacity = 64;
+        return runEquityServer(socketPath, numWorkers, static_cast<size_t>(queueCapacity), pinThreads, cacheForRuns);
     }
-    return true;
-}
 
-// Main function
-int main() {
-    cout << "=== Poker Odds Simulator ===\n\n";
+    cout << (omaha ? "=== Poker Odds Simulator (Omaha) ===\n\n" : "=== Poker Odds Simulator ===\n\n");
 
     vector<Card> player1Hand;
     vector<Card> player2Hand;
@@ -653,7 +855,7 @@ int main() {
 
     // Get Player 1's hand
     while (true) {
-        if (getUserHand(player1Hand, "Player 1", usedCards))
+        if (getUserHand(player1Hand, "Player 1", usedCards, handSize))
             break;
         else {
             player1Hand.clear();
@@ -662,9 +864,9 @@ int main() {
         }
     }
 
-    // Get Player 2's hand
-    while (true) {
-        if (getUserHand(player2Hand, "Player 2", usedCards))
+    // Get Player 2's hand, unless Player 1 faces random opponents
+    while (opponents == 0) {
+        if (getUserHand(player2Hand, "Player 2", usedCards, handSize))
             break;
         else {
             player2Hand.clear();
@@ -699,8 +901,13 @@ int main() {
     cout << "\n--- Input Summary ---\n";
     cout << "Player 1's Hand: ";
     for (const auto& card : player1Hand) cout << cardToString(card) << " ";
-    cout << "\nPlayer 2's Hand: ";
-    for (const auto& card : player2Hand) cout << cardToString(card) << " ";
+    if (opponents > 0) {
+        cout << "\nOpponents: " << opponents << " random hand(s)";
+    }
+    else {
+        cout << "\nPlayer 2's Hand: ";
+        for (const auto& card : player2Hand) cout << cardToString(card) << " ";
+    }
     cout << "\nGame Stage: " << gameStage;
     if (!communityCards.empty()) {
         cout << "\nCommunity Cards: ";
@@ -708,38 +915,92 @@ int main() {
     }
     cout << "\n----------------------\n";
 
-    // Initialize Simulator
-    Simulator simulator(player1Hand, player2Hand, gameStage, communityCards);
+    if (progressive) {
+        cout << "\nRunning progressive simulation until the 95% confidence intervals are within +/- "
+            << targetInterval << " points...\n";
+        runProgressive(player1Hand, player2Hand, gameStage, communityCards, targetInterval, maxTrials);
+        cout << "\n==============================\n";
+        cout << "Simulation complete. Thank you!\n";
+        return 0;
+    }
 
     // Number of trials
     int trials = 100000;
-    cout << "\nRunning Monte Carlo simulations with " << trials << " trials...\n";
 
-    // Run map-based simulation
-    double p1WinMap = 0.0, p2WinMap = 0.0, tieMap = 0.0;
-    long long execTimeMap = 0;
-    simulator.runSimulationMap(trials, p1WinMap, p2WinMap, tieMap, execTimeMap);
+    if (opponents > 0) {
+        // The turn and river are enumerated exactly when the deal count allows
+        MultiwaySimulator multiway(player1Hand, communityCards, opponents);
+        MultiwayEquity result;
+        long long execTime = 0;
+        if (multiway.canEnumerate()) {
+            cout << "\nEnumerating every runout and opponent deal exactly...\n";
+            multiway.runEnumeration(result, execTime);
+        }
+        else {
+            cout << "\nRunning Monte Carlo simulations with " << trials << " trials...\n";
+            multiway.runSimulation(trials, result, execTime);
+        }
 
-    // Run hash table-based simulation
-    double p1WinHash = 0.0, p2WinHash = 0.0, tieHash = 0.0;
-    long long execTimeHash = 0;
-    simulator.runSimulationHash(trials, p1WinHash, p2WinHash, tieHash, execTimeHash);
+        cout << fixed << setprecision(2);
+        cout << "\n--- Simulation Results ---\n";
+        cout << "\nPlayer 1 vs " << opponents << " Random Opponent(s)" << (result.exact ? " (exact)" : "") << ":\n";
+        cout << "Win %: " << result.win << "%\n";
+        cout << "Tie %: " << result.tie << "%\n";
+        cout << "Lose %: " << result.lose << "%\n";
+        cout << "Equity %: " << result.equity << "%\n";
+        cout << (result.exact ? "Deals Enumerated: " : "Trials: ") << result.samples << "\n";
+        cout << "Simulation Time: " << execTime << " ms\n";
+        cout << "\n==============================\n";
+        cout << "Simulation complete. Thank you!\n";
+        return 0;
+    }
 
-    // Output results
+    cout << "\nRunning Monte Carlo simulations with " << trials << " trials...\n";
+
+    if (omaha) {
+        OmahaSimulator omahaSimulator(player1Hand, player2Hand, gameStage, communityCards);
+        double p1Win = 0.0, p2Win = 0.0, tie = 0.0;
+        long long execTime = 0;
+        omahaSimulator.runSimulation(trials, p1Win, p2Win, tie, execTime);
+
+        cout << fixed << setprecision(2);
+        cout << "\n--- Simulation Results ---\n";
+        cout << "\nOmaha Results:\n";
+        cout << "Player 1 Win %: " << p1Win << "%\n";
+        cout << "Player 2 Win %: " << p2Win << "%\n";
+        cout << "Tie %: " << tie << "%\n";
+        cout << "Simulation Time: " << execTime << " ms\n";
+        cout << "\n==============================\n";
+        cout << "Simulation complete. Thank you!\n";
+        return 0;
+    }
+
+    // Initialize Simulator
+    Simulator simulator(player1Hand, player2Hand, gameStage, communityCards);
+    // A cached answer would skip the trial loop being profiled
+    if (!profile)
+        simulator.setCache(cacheForRuns);
+    // Hardware counters are only opened when profiling
+    auto readCounters = [profile] { return profile ? PerfCounters::forThisThread().read() : PerfSample(); };
+
+    // Run each selected backend in turn
+    static const char* const backendTitles[EVAL_BACKEND_COUNT] = { "Map-Based", "Hash Table-Based", "Seven-Card Bitmask" };
     cout << fixed << setprecision(2);
     cout << "\n--- Simulation Results ---\n";
-
-    cout << "\nMap-Based Results:\n";
-    cout << "Player 1 Win %: " << p1WinMap << "%\n";
-    cout << "Player 2 Win %: " << p2WinMap << "%\n";
-    cout << "Tie %: " << tieMap << "%\n";
-    cout << "Simulation Time: " << execTimeMap << " ms\n";
-
-    cout << "\nHash Table-Based Results:\n";
-    cout << "Player 1 Win %: " << p1WinHash << "%\n";
-    cout << "Player 2 Win %: " << p2WinHash << "%\n";
-    cout << "Tie %: " << tieHash << "%\n";
-    cout << "Simulation Time: " << execTimeHash << " ms\n";
+    for (EvaluatorBackend backend : backends) {
+        double p1Win = 0.0, p2Win = 0.0, tie = 0.0;
+        long long execTime = 0;
+        PerfSample start = readCounters();
+        simulator.runSimulation(backend, trials, p1Win, p2Win, tie, execTime);
+        PerfSample perf = readCounters() - start;
+
+        cout << "\n" << backendTitles[backend] << " Results:\n";
+        cout << "Player 1 Win %: " << p1Win << "%\n";
+        cout << "Player 2 Win %: " << p2Win << "%\n";
+        cout << "Tie %: " << tie << "%\n";
+        cout << "Simulation Time: " << execTime << " ms\n";
+        if (profile) printPerfProfile(perf, trials);
+    }
 
     cout << "\n==============================\n";
     cout << "Simulation complete. Thank you!\n";
@@ -0,0 +1,2186 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <unordered_set>
+#include <iomanip>
+#include <sstream>
+#include <map>
+#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include <utility>
+#include <cmath>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Enumerations for Suit and Rank
+enum Suit { HEARTS, DIAMONDS, CLUBS, SPADES };
+enum Rank {
+    TWO = 2, THREE, FOUR, FIVE, SIX, SEVEN,
+    EIGHT, NINE, TEN, JACK, QUEEN, KING, ACE
+};
+
+// Structure to represent a Card
+struct Card {
+    Suit suit;
+    Rank rank;
+
+    Card(Suit s, Rank r) : suit(s), rank(r) {}
+
+    // Overload == operator for comparison
+    bool operator==(const Card& other) const {
+        return (suit == other.suit) && (rank == other.rank);
+    }
+};
+
+// Function to convert card string to Card object
+inline bool parseCard(const string& cardStr, Card& card) {
+    if (cardStr.length() < 2 || cardStr.length() > 3)
+        return false;
+
+    // Parse rank
+    string rankStr = "";
+    if (cardStr.length() == 3) { // e.g., "10s"
+        rankStr = cardStr.substr(0, 2);
+    }
+    else {
+        rankStr = cardStr.substr(0, 1);
+    }
+
+    // Parse suit
+    char suitChar = cardStr.back();
+
+    // Determine rank
+    Rank rank;
+    if (rankStr == "2") rank = TWO;
+    else if (rankStr == "3") rank = THREE;
+    else if (rankStr == "4") rank = FOUR;
+    else if (rankStr == "5") rank = FIVE;
+    else if (rankStr == "6") rank = SIX;
+    else if (rankStr == "7") rank = SEVEN;
+    else if (rankStr == "8") rank = EIGHT;
+    else if (rankStr == "9") rank = NINE;
+    else if (rankStr == "10") rank = TEN;
+    else if (rankStr == "J" || rankStr == "j") rank = JACK;
+    else if (rankStr == "Q" || rankStr == "q") rank = QUEEN;
+    else if (rankStr == "K" || rankStr == "k") rank = KING;
+    else if (rankStr == "A" || rankStr == "a") rank = ACE;
+    else return false;
+
+    // Determine suit
+    Suit suit;
+    switch (toupper(suitChar)) {
+    case 'H': suit = HEARTS; break;
+    case 'D': suit = DIAMONDS; break;
+    case 'C': suit = CLUBS; break;
+    case 'S': suit = SPADES; break;
+    default: return false;
+    }
+
+    card = Card(suit, rank);
+    return true;
+}
+
+// Function to convert Card object to string
+inline string cardToString(const Card& card) {
+    string rankStr;
+    switch (card.rank) {
+    case TWO: rankStr = "2"; break;
+    case THREE: rankStr = "3"; break;
+    case FOUR: rankStr = "4"; break;
+    case FIVE: rankStr = "5"; break;
+    case SIX: rankStr = "6"; break;
+    case SEVEN: rankStr = "7"; break;
+    case EIGHT: rankStr = "8"; break;
+    case NINE: rankStr = "9"; break;
+    case TEN: rankStr = "10"; break;
+    case JACK: rankStr = "J"; break;
+    case QUEEN: rankStr = "Q"; break;
+    case KING: rankStr = "K"; break;
+    case ACE: rankStr = "A"; break;
+    }
+
+    string suitStr;
+    switch (card.suit) {
+    case HEARTS: suitStr = "h"; break;
+    case DIAMONDS: suitStr = "d"; break;
+    case CLUBS: suitStr = "c"; break;
+    case SPADES: suitStr = "s"; break;
+    }
+
+    return rankStr + suitStr;
+}
+
+// Cards are numbered 0-51 as suit * 13 + (rank - 2), the same order Deck builds
+// them in, so a set of cards fits in a 64-bit mask.
+
+// Function to convert Card object to its 0-51 index
+inline int cardIndex(const Card& card) {
+    return card.suit * 13 + (card.rank - TWO);
+}
+
+// Function to convert a 0-51 index back to a Card object
+inline Card cardFromIndex(int index) {
+    return Card(static_cast<Suit>(index / 13), static_cast<Rank>(index % 13 + TWO));
+}
+
+// 256-entry character tables used by parseCardList
+struct CardCharTables {
+    static constexpr int8_t INVALID = -1;
+    static constexpr int8_t TEN_PREFIX = 13; // '1', must be followed by '0'
+
+    int8_t rank[256];
+    int8_t suit[256];
+    bool space[256];
+
+    constexpr CardCharTables() : rank(), suit(), space() {
+        for (int c = 0; c < 256; ++c) {
+            rank[c] = INVALID;
+            suit[c] = INVALID;
+            space[c] = false;
+        }
+        for (int r = 0; r < 8; ++r) rank['2' + r] = static_cast<int8_t>(r);
+        rank['1'] = TEN_PREFIX;
+        rank['T'] = rank['t'] = TEN - TWO;
+        rank['J'] = rank['j'] = JACK - TWO;
+        rank['Q'] = rank['q'] = QUEEN - TWO;
+        rank['K'] = rank['k'] = KING - TWO;
+        rank['A'] = rank['a'] = ACE - TWO;
+        suit['H'] = suit['h'] = HEARTS;
+        suit['D'] = suit['d'] = DIAMONDS;
+        suit['C'] = suit['c'] = CLUBS;
+        suit['S'] = suit['s'] = SPADES;
+        space[' '] = space['\t'] = space['\r'] = space['\n'] = true;
+    }
+};
+
+constexpr CardCharTables CARD_CHARS;
+
+// Structure to report the outcome of parseCardList
+struct CardParseResult {
+    int count = 0;               // Cards decoded
+    uint64_t mask = 0;           // Bit i set for every decoded card index i
+    int errorPos = -1;           // Offset into the input of the first error, -1 on success
+    const char* error = nullptr; // Static description of the error
+
+    bool ok() const { return errorPos < 0; }
+};
+
+// Function to decode a whitespace-separated list of cards (e.g. "As 10d kh")
+// straight into card indices without allocating. Cards already present in
+// usedMask are reported as duplicates. Returns false on the first error.
+inline bool parseCardList(string_view text, uint8_t* indices, int maxCards, uint64_t usedMask, CardParseResult& result) {
+    result = CardParseResult();
+    const size_t n = text.size();
+    size_t i = 0;
+
+    auto fail = [&](size_t pos, const char* message) {
+        result.errorPos = static_cast<int>(pos);
+        result.error = message;
+        return false;
+    };
+
+    while (i < n) {
+        unsigned char ch = static_cast<unsigned char>(text[i]);
+        if (CARD_CHARS.space[ch]) {
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+        int rank = CARD_CHARS.rank[ch];
+        if (rank == CardCharTables::INVALID)
+            return fail(i, "invalid rank");
+        if (rank == CardCharTables::TEN_PREFIX) {
+            if (i + 1 >= n || text[i + 1] != '0')
+                return fail(i + 1, "expected '0' after '1'");
+            rank = TEN - TWO;
+            ++i;
+        }
+        ++i;
+
+        if (i >= n)
+            return fail(i, "missing suit");
+        int suit = CARD_CHARS.suit[static_cast<unsigned char>(text[i])];
+        if (suit == CardCharTables::INVALID)
+            return fail(i, "invalid suit");
+        ++i;
+        if (i < n && !CARD_CHARS.space[static_cast<unsigned char>(text[i])])
+            return fail(i, "unexpected character after card");
+
+        int index = suit * 13 + rank;
+        uint64_t bit = uint64_t(1) << index;
+        if ((usedMask | result.mask) & bit)
+            return fail(start, "duplicate card");
+        if (result.count == maxCards)
+            return fail(start, "too many cards");
+        indices[result.count++] = static_cast<uint8_t>(index);
+        result.mask |= bit;
+    }
+    return true;
+}
+
+// Equity does not change when suits are relabelled, so a spot can be reduced to a
+// canonical key: the smallest relabelling of its card masks.
+
+// Function to build the 64-bit mask of a set of cards
+inline uint64_t cardMask(const vector<Card>& cards) {
+    uint64_t mask = 0;
+    for (const auto& card : cards) mask |= uint64_t(1) << cardIndex(card);
+    return mask;
+}
+
+// Function to expand a card mask back into cards (ascending index)
+inline vector<Card> cardsFromMask(uint64_t mask) {
+    vector<Card> cards;
+    while (mask) {
+        int index = __builtin_ctzll(mask);
+        cards.push_back(cardFromIndex(index));
+        mask &= mask - 1;
+    }
+    return cards;
+}
+
+// All 24 relabellings of the four suits
+struct SuitPermutations {
+    int perms[24][4];
+
+    SuitPermutations() {
+        int p[4] = { 0, 1, 2, 3 };
+        int i = 0;
+        do {
+            copy(p, p + 4, perms[i++]);
+        } while (next_permutation(p, p + 4));
+    }
+
+    // Function to move each suit's 13-bit block to its relabelled suit
+    static uint64_t apply(uint64_t mask, const int* perm) {
+        uint64_t out = 0;
+        for (int s = 0; s < 4; ++s)
+            out |= ((mask >> (13 * s)) & 0x1FFF) << (13 * perm[s]);
+        return out;
+    }
+};
+
+inline const SuitPermutations SUIT_PERMUTATIONS;
+
+// Structure to represent a canonical spot: board, Player 1 and Player 2 masks
+struct SpotKey {
+    uint64_t board, p1, p2;
+
+    bool operator<(const SpotKey& other) const {
+        if (board != other.board) return board < other.board;
+        if (p1 != other.p1) return p1 < other.p1;
+        return p2 < other.p2;
+    }
+
+    bool operator==(const SpotKey& other) const {
+        return board == other.board && p1 == other.p1 && p2 == other.p2;
+    }
+};
+
+struct SpotKeyHash {
+    size_t operator()(const SpotKey& key) const {
+        uint64_t h = key.board * 0x9E3779B97F4A7C15ULL;
+        h ^= key.p1 + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+        h ^= key.p2 + 0x85157AF5ULL + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+// Function to find the lexicographically smallest relabelling of a spot
+inline SpotKey canonicalSpot(uint64_t board, uint64_t p1, uint64_t p2) {
+    SpotKey best{ ~uint64_t(0), 0, 0 };
+    for (const auto& perm : SUIT_PERMUTATIONS.perms) {
+        SpotKey key{ SuitPermutations::apply(board, perm), SuitPermutations::apply(p1, perm), SuitPermutations::apply(p2, perm) };
+        if (key < best) best = key;
+    }
+    return best;
+}
+
+// Number of hand categories (High Card = 1 to Straight Flush = 9)
+const int HAND_CATEGORY_COUNT = 9;
+
+// Display names of the hand categories (index 1-9)
+inline const char* const HAND_CATEGORY_NAMES[HAND_CATEGORY_COUNT + 1] = {
+    "", "High Card", "One Pair", "Two Pair", "Three of a Kind", "Straight",
+    "Flush", "Full House", "Four of a Kind", "Straight Flush"
+};
+
+// Dataset column suffixes of the hand categories (index 1-9)
+inline const char* const HAND_CATEGORY_LABELS[HAND_CATEGORY_COUNT + 1] = {
+    "", "HighCard", "OnePair", "TwoPair", "ThreeOfAKind", "Straight",
+    "Flush", "FullHouse", "FourOfAKind", "StraightFlush"
+};
+
+// Structure to count how often each player finishes with each hand category;
+// counts[player][category - 1]
+struct CategoryHistogram {
+    long long counts[2][HAND_CATEGORY_COUNT] = {};
+
+    void add(const CategoryHistogram& other) {
+        for (int p = 0; p < 2; ++p)
+            for (int c = 0; c < HAND_CATEGORY_COUNT; ++c) counts[p][c] += other.counts[p][c];
+    }
+};
+
+// Structure to represent evaluated hand value
+struct HandValue {
+    int category; // 1 to 9
+    vector<int> tiebreakers; // For comparing hands within the same category
+
+    bool operator<(const HandValue& other) const {
+        if (category != other.category)
+            return category < other.category;
+        for (size_t i = 0; i < tiebreakers.size(); ++i) {
+            if (i >= other.tiebreakers.size())
+                return false;
+            if (tiebreakers[i] != other.tiebreakers[i])
+                return tiebreakers[i] < other.tiebreakers[i];
+        }
+        return false;
+    }
+
+    bool operator>(const HandValue& other) const {
+        return other < *this;
+    }
+
+    bool operator==(const HandValue& other) const {
+        return (category == other.category) && (tiebreakers == other.tiebreakers);
+    }
+};
+
+// Function to get the category (1-9) of an evaluated hand
+inline int handCategory(const HandValue& value) {
+    return value.category;
+}
+
+// Function to get the category (1-9) of a packed score (see FiveCardEvaluator::pack)
+inline int handCategory(int score) {
+    return score >> 20;
+}
+
+// Deck class to manage cards
+class Deck {
+public:
+    vector<Card> cards;
+
+    Deck(const vector<Card>& excludedCards) {
+        // Initialize full deck
+        for (int s = HEARTS; s <= SPADES; ++s) {
+            for (int r = TWO; r <= ACE; ++r) {
+                Card card(static_cast<Suit>(s), static_cast<Rank>(r));
+                // Check if card is excluded
+                bool excluded = false;
+                for (const auto& ec : excludedCards) {
+                    if (card == ec) {
+                        excluded = true;
+                        break;
+                    }
+                }
+                if (!excluded)
+                    cards.push_back(card);
+            }
+        }
+    }
+
+    void shuffleDeck() {
+        random_device rd;
+        mt19937 g(rd());
+        shuffle(cards.begin(), cards.end(), g);
+    }
+};
+
+// HandEvaluator class to evaluate poker hands
+class HandEvaluator {
+public:
+    // Map-based hand evaluation
+    HandValue evaluateHandMap(const vector<Card>& hand) {
+        // Use std::map for counting
+        map<int, int> rankCount;
+        map<Suit, int> suitCount;
+        return evaluateHandGeneric(hand, rankCount, suitCount);
+    }
+
+    // Hash table-based hand evaluation
+    HandValue evaluateHandHash(const vector<Card>& hand) {
+        // Use std::unordered_map for counting
+        unordered_map<int, int> rankCount;
+        unordered_map<Suit, int> suitCount;
+        return evaluateHandGeneric(hand, rankCount, suitCount);
+    }
+
+private:
+    template<typename RankMap, typename SuitMap>
+    HandValue evaluateHandGeneric(const vector<Card>& hand, RankMap& rankCount, SuitMap& suitCount) {
+        // Sort the hand by rank descending
+        vector<Card> sortedHand = hand;
+        sort(sortedHand.begin(), sortedHand.end(), [&](const Card& a, const Card& b) {
+            return a.rank > b.rank;
+            });
+
+        vector<int> ranks;
+        for (const auto& card : sortedHand) {
+            rankCount[card.rank]++;
+            suitCount[card.suit]++;
+            ranks.push_back(card.rank);
+        }
+
+        bool isFlush = false;
+        Suit flushSuit;
+        for (const auto& sc : suitCount) {
+            if (sc.second >= 5) {
+                isFlush = true;
+                flushSuit = sc.first;
+                break;
+            }
+        }
+
+        // Extract ranks for straight
+        vector<int> uniqueRanks;
+        for (const auto& rc : rankCount) {
+            uniqueRanks.push_back(rc.first);
+        }
+        sort(uniqueRanks.begin(), uniqueRanks.end(), greater<int>());
+
+        // Check for straight (including Ace-low)
+        bool isStraight = false;
+        int highStraight = 0;
+        if (uniqueRanks.size() >= 5) {
+            for (size_t i = 0; i <= uniqueRanks.size() - 5; ++i) {
+                bool consecutive = true;
+                for (size_t j = 0; j < 4; ++j) {
+                    if (uniqueRanks[i + j] - 1 != uniqueRanks[i + j + 1]) {
+                        consecutive = false;
+                        break;
+                    }
+                }
+                if (consecutive) {
+                    isStraight = true;
+                    highStraight = uniqueRanks[i];
+                    break;
+                }
+            }
+            // Check for Ace-low straight
+            if (!isStraight) {
+                // A, 2, 3, 4, 5
+                if (find(uniqueRanks.begin(), uniqueRanks.end(), ACE) != uniqueRanks.end() &&
+                    find(uniqueRanks.begin(), uniqueRanks.end(), TWO) != uniqueRanks.end() &&
+                    find(uniqueRanks.begin(), uniqueRanks.end(), THREE) != uniqueRanks.end() &&
+                    find(uniqueRanks.begin(), uniqueRanks.end(), FOUR) != uniqueRanks.end() &&
+                    find(uniqueRanks.begin(), uniqueRanks.end(), FIVE) != uniqueRanks.end()) {
+                    isStraight = true;
+                    highStraight = FIVE;
+                }
+            }
+        }
+
+        // Check for straight flush
+        bool isStraightFlush = false;
+        int highStraightFlush = 0;
+        if (isFlush) {
+            // Extract cards of the flush suit
+            vector<Card> flushCards;
+            for (const auto& card : sortedHand) {
+                if (card.suit == flushSuit)
+                    flushCards.push_back(card);
+            }
+            // Check for straight in flushCards
+            vector<int> flushRanks;
+            unordered_map<int, int> flushRankCount;
+            for (const auto& card : flushCards) {
+                flushRankCount[card.rank]++;
+                flushRanks.push_back(card.rank);
+            }
+            sort(flushRanks.begin(), flushRanks.end(), greater<int>());
+            // Remove duplicates
+            flushRanks.erase(unique(flushRanks.begin(), flushRanks.end()), flushRanks.end());
+
+            if (flushRanks.size() >= 5) {
+                for (size_t i = 0; i <= flushRanks.size() - 5; ++i) {
+                    bool consecutive = true;
+                    for (size_t j = 0; j < 4; ++j) {
+                        if (flushRanks[i + j] - 1 != flushRanks[i + j + 1]) {
+                            consecutive = false;
+                            break;
+                        }
+                    }
+                    if (consecutive) {
+                        isStraightFlush = true;
+                        highStraightFlush = flushRanks[i];
+                        break;
+                    }
+                }
+                // Check for Ace-low straight flush
+                if (!isStraightFlush) {
+                    if (find(flushRanks.begin(), flushRanks.end(), ACE) != flushRanks.end() &&
+                        find(flushRanks.begin(), flushRanks.end(), TWO) != flushRanks.end() &&
+                        find(flushRanks.begin(), flushRanks.end(), THREE) != flushRanks.end() &&
+                        find(flushRanks.begin(), flushRanks.end(), FOUR) != flushRanks.end() &&
+                        find(flushRanks.begin(), flushRanks.end(), FIVE) != flushRanks.end()) {
+                        isStraightFlush = true;
+                        highStraightFlush = FIVE;
+                    }
+                }
+            }
+        }
+
+        // Determine hand category and tiebreakers
+        HandValue hv;
+        if (isStraightFlush) {
+            hv.category = 9; // Straight Flush
+            hv.tiebreakers.push_back(highStraightFlush);
+        }
+        else {
+            // Check for Four of a Kind
+            bool fourKind = false;
+            int fourRank = 0;
+            for (const auto& rc : rankCount) {
+                if (rc.second == 4) {
+                    fourKind = true;
+                    fourRank = rc.first;
+                    break;
+                }
+            }
+            if (fourKind) {
+                hv.category = 8; // Four of a Kind
+                hv.tiebreakers.push_back(fourRank);
+                // Add highest kicker
+                for (const auto& card : sortedHand) {
+                    if (card.rank != fourRank) {
+                        hv.tiebreakers.push_back(card.rank);
+                        break;
+                    }
+                }
+            }
+            else {
+                // Check for Full House
+                bool threeKind = false;
+                int threeRank = 0;
+                int threeKinds = 0;
+                vector<int> pairs;
+                for (const auto& rc : rankCount) {
+                    if (rc.second == 3) {
+                        threeKinds++;
+                        if (!threeKind || rc.first > threeRank) {
+                            threeKind = true;
+                            threeRank = rc.first;
+                        }
+                    }
+                    else if (rc.second == 2) {
+                        pairs.push_back(rc.first);
+                    }
+                }
+                // A full house needs a pair or a second three of a kind
+                if (threeKind && (pairs.size() >= 1 || threeKinds >= 2)) {
+                    hv.category = 7; // Full House
+                    hv.tiebreakers.push_back(threeRank);
+                    // Find the highest pair
+                    int highestPair = 0;
+                    for (const auto& pr : pairs) {
+                        if (pr > highestPair) highestPair = pr;
+                    }
+                    // If no pairs, find second three of a kind
+                    if (highestPair == 0) {
+                        for (const auto& rc : rankCount) {
+                            if (rc.second == 3 && rc.first != threeRank) {
+                                if (rc.first > highestPair) highestPair = rc.first;
+                            }
+                        }
+                    }
+                    hv.tiebreakers.push_back(highestPair);
+                }
+                else {
+                    // Check for Flush
+                    if (isFlush) {
+                        hv.category = 6; // Flush
+                        // Add top five cards of flush
+                        int count = 0;
+                        for (const auto& card : sortedHand) {
+                            if (card.suit == flushSuit) {
+                                hv.tiebreakers.push_back(card.rank);
+                                count++;
+                                if (count == 5) break;
+                            }
+                        }
+                    }
+                    else {
+                        // Check for Straight
+                        if (isStraight) {
+                            hv.category = 5; // Straight
+                            hv.tiebreakers.push_back(highStraight);
+                        }
+                        else {
+                            // Check for Three of a Kind
+                            if (threeKind) {
+                                hv.category = 4; // Three of a Kind
+                                hv.tiebreakers.push_back(threeRank);
+                                // Add two highest kickers
+                                int kickers = 0;
+                                for (const auto& card : sortedHand) {
+                                    if (card.rank != threeRank) {
+                                        hv.tiebreakers.push_back(card.rank);
+                                        kickers++;
+                                        if (kickers == 2) break;
+                                    }
+                                }
+                            }
+                            else {
+                                // Check for Two Pair
+                                vector<int> pairsFound;
+                                for (const auto& rc : rankCount) {
+                                    if (rc.second == 2) {
+                                        pairsFound.push_back(rc.first);
+                                    }
+                                }
+                                if (pairsFound.size() >= 2) {
+                                    hv.category = 3; // Two Pair
+                                    sort(pairsFound.begin(), pairsFound.end(), greater<int>());
+                                    hv.tiebreakers.push_back(pairsFound[0]);
+                                    hv.tiebreakers.push_back(pairsFound[1]);
+                                    // Add highest kicker
+                                    for (const auto& card : sortedHand) {
+                                        if (card.rank != pairsFound[0] && card.rank != pairsFound[1]) {
+                                            hv.tiebreakers.push_back(card.rank);
+                                            break;
+                                        }
+                                    }
+                                }
+                                else {
+                                    // Check for One Pair
+                                    if (pairsFound.size() == 1) {
+                                        hv.category = 2; // One Pair
+                                        hv.tiebreakers.push_back(pairsFound[0]);
+                                        // Add three highest kickers
+                                        int kickers = 0;
+                                        for (const auto& card : sortedHand) {
+                                            if (card.rank != pairsFound[0]) {
+                                                hv.tiebreakers.push_back(card.rank);
+                                                kickers++;
+                                                if (kickers == 3) break;
+                                            }
+                                        }
+                                    }
+                                    else {
+                                        // High Card
+                                        hv.category = 1; // High Card
+                                        // Add top five cards
+                                        for (int i = 0; i < 5 && i < sortedHand.size(); ++i) {
+                                            hv.tiebreakers.push_back(sortedHand[i].rank);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        return hv;
+    }
+};
+
+// Persistent equity cache: a hash table in a memory-mapped file, shared by every process
+// that opens it, with each slot guarded by a sequence counter (odd while being written).
+
+// Structure to represent a cached result as raw counts
+struct CachedEquity {
+    uint64_t p1Wins = 0;
+    uint64_t p2Wins = 0;
+    uint64_t ties = 0;
+    uint64_t trials = 0; // Boards for exact results
+    bool exact = false;
+};
+
+class EquityCache {
+private:
+    static constexpr uint64_t MAGIC = 0x48434145514B5050ULL; // "PPKQEACH"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 4096;
+    static constexpr int MAX_PROBES = 64;
+    static constexpr int MAX_SPINS = 1 << 20;
+    static constexpr int STALE_WRITE_MICROS = 20000; // Writers hold a slot for a few stores
+
+    struct FileHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t slotSize;
+        uint64_t capacity;
+    };
+
+    struct Slot {
+        atomic<uint32_t> sequence;
+        atomic<uint32_t> exact;
+        atomic<uint64_t> board;
+        atomic<uint64_t> p1;
+        atomic<uint64_t> p2;
+        atomic<uint64_t> p1Wins;
+        atomic<uint64_t> p2Wins;
+        atomic<uint64_t> ties;
+        atomic<uint64_t> trials;
+    };
+    static_assert(sizeof(Slot) == 64, "cache slots must fill one cache line");
+    static_assert(atomic<uint64_t>::is_always_lock_free, "cache needs lock-free 64-bit atomics");
+
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    Slot* slots = nullptr;
+    uint64_t capacity = 0;
+
+public:
+    static constexpr uint64_t DEFAULT_SLOTS = uint64_t(1) << 20; // 64 MB
+
+    EquityCache() = default;
+    EquityCache(const EquityCache&) = delete;
+    EquityCache& operator=(const EquityCache&) = delete;
+
+    ~EquityCache() {
+        close();
+    }
+
+    // Function to open (or create with the given slot count) a cache file.
+    // An existing file keeps its own size.
+    bool open(const string& path, uint64_t requestedSlots, string& error) {
+        close();
+        uint64_t slotCount = 1;
+        while (slotCount < requestedSlots) slotCount <<= 1;
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            error = "cannot open " + path + ": " + strerror(errno);
+            return false;
+        }
+
+        // Serialise initialisation between processes
+        flock(fd, LOCK_EX);
+        struct stat st {};
+        fstat(fd, &st);
+        FileHeader header{};
+        bool ok = true;
+        if (st.st_size == 0) {
+            header = { MAGIC, VERSION, static_cast<uint32_t>(sizeof(Slot)), slotCount };
+            ok = ftruncate(fd, static_cast<off_t>(HEADER_SIZE + slotCount * sizeof(Slot))) == 0 &&
+                pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+            if (!ok) error = string("cannot initialise cache: ") + strerror(errno);
+        }
+        else if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            header.magic != MAGIC || header.version != VERSION || header.slotSize != sizeof(Slot) ||
+            header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0 ||
+            static_cast<uint64_t>(st.st_size) < HEADER_SIZE + header.capacity * sizeof(Slot)) {
+            error = path + " is not a compatible equity cache";
+            ok = false;
+        }
+        flock(fd, LOCK_UN);
+        if (!ok) {
+            close();
+            return false;
+        }
+
+        capacity = header.capacity;
+        mappingSize = HEADER_SIZE + capacity * sizeof(Slot);
+        mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            error = string("cannot map cache: ") + strerror(errno);
+            mapping = nullptr;
+            close();
+            return false;
+        }
+        slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + HEADER_SIZE);
+        return true;
+    }
+
+    bool isOpen() const {
+        return slots != nullptr;
+    }
+
+    uint64_t slotCount() const {
+        return capacity;
+    }
+
+    void close() {
+        if (mapping) munmap(mapping, mappingSize);
+        if (fd >= 0) ::close(fd);
+        mapping = nullptr;
+        slots = nullptr;
+        fd = -1;
+        capacity = 0;
+    }
+
+    // Function to look up a spot; returns false when it is not cached
+    bool lookup(const SpotKey& key, CachedEquity& result) const {
+        if (!slots) return false;
+        uint64_t start = SpotKeyHash()(key);
+        for (int probe = 0; probe < MAX_PROBES; ++probe) {
+            const Slot& slot = slots[(start + probe) & (capacity - 1)];
+            bool matched = false;
+            if (!readSlot(slot, key, result, matched))
+                return false; // Empty slot: end of the probe chain
+            if (matched)
+                return true;
+        }
+        return false;
+    }
+
+    // Function to add a result to the cache. Exact results replace pooled
+    // Monte Carlo counts; Monte Carlo counts never replace an exact result.
+    // The entry as stored afterwards is returned in merged.
+    bool merge(const SpotKey& key, const CachedEquity& add, CachedEquity& merged) {
+        if (!slots) return false;
+        uint64_t start = SpotKeyHash()(key);
+        for (int probe = 0; probe < MAX_PROBES; ++probe) {
+            Slot& slot = slots[(start + probe) & (capacity - 1)];
+            for (int spin = 0; spin < MAX_SPINS; ++spin) {
+                uint32_t seq = waitForWriter(slot);
+                // Still odd means the writer died; a first write (1) may have
+                // left the key incomplete, later ones only the counts
+                bool reclaim = (seq & 1) != 0;
+                if (seq > 1 && !(slot.board.load(memory_order_relaxed) == key.board &&
+                    slot.p1.load(memory_order_relaxed) == key.p1 &&
+                    slot.p2.load(memory_order_relaxed) == key.p2))
+                    break; // Another spot: keep probing
+                uint32_t claimed = reclaim ? seq + 2 : seq + 1;
+                if (!slot.sequence.compare_exchange_weak(seq, claimed, memory_order_acquire))
+                    continue;
+                // Order the data stores below after the odd sequence
+                atomic_thread_fence(memory_order_release);
+
+                if (seq <= 1) {
+                    slot.board.store(key.board, memory_order_relaxed);
+                    slot.p1.store(key.p1, memory_order_relaxed);
+                    slot.p2.store(key.p2, memory_order_relaxed);
+                    storeCounts(slot, add);
+                    merged = add;
+                }
+                else {
+                    CachedEquity current = reclaim ? CachedEquity() : loadCounts(slot);
+                    if (current.exact) {
+                        merged = current;
+                    }
+                    else if (add.exact) {
+                        storeCounts(slot, add);
+                        merged = add;
+                    }
+                    else {
+                        current.p1Wins += add.p1Wins;
+                        current.p2Wins += add.p2Wins;
+                        current.ties += add.ties;
+                        current.trials += add.trials;
+                        storeCounts(slot, current);
+                        merged = current;
+                    }
+                }
+                // Back to even, skipping 0 which means empty. This fails only
+                // if the slot was reclaimed from a writer stalled past
+                // STALE_WRITE_MICROS; that write is then lost.
+                uint32_t next = claimed + 1;
+                return slot.sequence.compare_exchange_strong(claimed, next == 0 ? 2 : next, memory_order_release);
+            }
+        }
+        return false; // Probe chain full
+    }
+
+private:
+    static CachedEquity loadCounts(const Slot& slot) {
+        CachedEquity counts;
+        counts.p1Wins = slot.p1Wins.load(memory_order_relaxed);
+        counts.p2Wins = slot.p2Wins.load(memory_order_relaxed);
+        counts.ties = slot.ties.load(memory_order_relaxed);
+        counts.trials = slot.trials.load(memory_order_relaxed);
+        counts.exact = slot.exact.load(memory_order_relaxed) != 0;
+        return counts;
+    }
+
+    static void storeCounts(Slot& slot, const CachedEquity& counts) {
+        slot.p1Wins.store(counts.p1Wins, memory_order_relaxed);
+        slot.p2Wins.store(counts.p2Wins, memory_order_relaxed);
+        slot.ties.store(counts.ties, memory_order_relaxed);
+        slot.trials.store(counts.trials, memory_order_relaxed);
+        slot.exact.store(counts.exact ? 1 : 0, memory_order_relaxed);
+    }
+
+    // Function to wait while a writer holds a slot; returns the even
+    // sequence, or the odd one if the writer has not finished in time
+    static uint32_t waitForWriter(const Slot& slot) {
+        uint32_t seq = slot.sequence.load(memory_order_acquire);
+        if (!(seq & 1)) return seq;
+        auto deadline = chrono::steady_clock::now() + chrono::microseconds(STALE_WRITE_MICROS);
+        while (true) {
+            this_thread::yield();
+            seq = slot.sequence.load(memory_order_acquire);
+            if (!(seq & 1) || chrono::steady_clock::now() >= deadline) return seq;
+        }
+    }
+
+    // Function to take a consistent snapshot of a slot; returns false for an
+    // empty slot, and sets matched when it holds the wanted key. A stale
+    // slot matches nothing but does not end the probe chain.
+    static bool readSlot(const Slot& slot, const SpotKey& key, CachedEquity& result, bool& matched) {
+        matched = false;
+        for (int spin = 0; spin < MAX_SPINS; ++spin) {
+            uint32_t before = waitForWriter(slot);
+            if (before == 0)
+                return false;
+            if (before & 1)
+                return true;
+            SpotKey stored{ slot.board.load(memory_order_relaxed), slot.p1.load(memory_order_relaxed),
+                slot.p2.load(memory_order_relaxed) };
+            CachedEquity counts = loadCounts(slot);
+            atomic_thread_fence(memory_order_acquire);
+            if (slot.sequence.load(memory_order_relaxed) != before)
+                continue;
+            matched = stored == key;
+            if (matched) result = counts;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Enumeration for the game stage; the string form is parsed once at the API boundary
+enum GameStage { PREFLOP, FLOP, TURN, RIVER };
+
+// Function to convert game stage string to GameStage
+inline bool parseGameStage(const string& stageStr, GameStage& stage) {
+    if (stageStr == "preflop") stage = PREFLOP;
+    else if (stageStr == "flop") stage = FLOP;
+    else if (stageStr == "turn") stage = TURN;
+    else if (stageStr == "river") stage = RIVER;
+    else return false;
+    return true;
+}
+
+// Function to determine how many community cards are still to be dealt at a stage
+inline int cardsToDealAt(GameStage stage) {
+    switch (stage) {
+    case PREFLOP: return 5;
+    case FLOP: return 2;
+    case TURN: return 1;
+    default: return 0;
+    }
+}
+
+// Structure to represent the answer to a time-budgeted query
+struct BudgetedEquity {
+    double p1Win = 0.0;
+    double p2Win = 0.0;
+    double tie = 0.0;
+    long long trials = 0;       // Trials run, or boards enumerated when exact
+    double standardError = 0.0; // Of player 1's equity (wins + ties / 2), in percentage points
+    bool exact = false;
+    bool fromCache = false;
+};
+
+// Function to get the standard error of an equity estimate from win and tie
+// shares (0-1) over n trials; each trial scores 1, 1/2 or 0
+inline double equityStandardError(double winShare, double tieShare, long long n) {
+    if (n <= 1)
+        return 0.0;
+    double mean = winShare + tieShare / 2.0;
+    double meanSquare = winShare + tieShare / 4.0;
+    return sqrt(max(0.0, meanSquare - mean * mean) / static_cast<double>(n));
+}
+
+// Fast evaluator for exactly five cards. Scores compare like HandValue:
+// the category (1-9) in bits 20-23, then up to five 4-bit tiebreak ranks.
+struct FiveCardEvaluator {
+    static int pack(int category, int t0, int t1 = 0, int t2 = 0, int t3 = 0, int t4 = 0) {
+        return (category << 20) | (t0 << 16) | (t1 << 12) | (t2 << 8) | (t3 << 4) | t4;
+    }
+
+    // Function to score five ranks (2-14); flush is true when all five share a suit
+    static int score(int a, int b, int c, int d, int e, bool flush) {
+        int r[5] = { a, b, c, d, e };
+        // Sort descending
+        for (int i = 1; i < 5; ++i) {
+            int v = r[i];
+            int j = i - 1;
+            while (j >= 0 && r[j] < v) {
+                r[j + 1] = r[j];
+                --j;
+            }
+            r[j + 1] = v;
+        }
+
+        if (r[0] > r[1] && r[1] > r[2] && r[2] > r[3] && r[3] > r[4]) {
+            int top = 0;
+            if (r[0] - r[4] == 4) top = r[0];
+            else if (r[0] == ACE && r[1] == FIVE) top = FIVE; // A-5-4-3-2
+            if (flush && top) return pack(9, top);
+            if (flush) return pack(6, r[0], r[1], r[2], r[3], r[4]);
+            if (top) return pack(5, top);
+            return pack(1, r[0], r[1], r[2], r[3], r[4]);
+        }
+
+        // Group equal ranks, then order groups by size (ranks stay descending)
+        int groupRank[5], groupSize[5], groups = 0;
+        for (int i = 0; i < 5; ++i) {
+            if (groups > 0 && groupRank[groups - 1] == r[i]) {
+                groupSize[groups - 1]++;
+            }
+            else {
+                groupRank[groups] = r[i];
+                groupSize[groups++] = 1;
+            }
+        }
+        for (int i = 1; i < groups; ++i) {
+            int rank = groupRank[i], size = groupSize[i];
+            int j = i - 1;
+            while (j >= 0 && groupSize[j] < size) {
+                groupRank[j + 1] = groupRank[j];
+                groupSize[j + 1] = groupSize[j];
+                --j;
+            }
+            groupRank[j + 1] = rank;
+            groupSize[j + 1] = size;
+        }
+
+        if (groupSize[0] == 4) return pack(8, groupRank[0], groupRank[1]);
+        if (groupSize[0] == 3 && groupSize[1] == 2) return pack(7, groupRank[0], groupRank[1]);
+        if (groupSize[0] == 3) return pack(4, groupRank[0], groupRank[1], groupRank[2]);
+        if (groupSize[1] == 2) return pack(3, groupRank[0], groupRank[1], groupRank[2]);
+        return pack(2, groupRank[0], groupRank[1], groupRank[2], groupRank[3]);
+    }
+};
+
+// SevenCardEvaluator class to score five to seven cards from a 0-51 card mask with
+// bitwise operations; scores use FiveCardEvaluator's packing.
+
+struct SevenCardEvaluator {
+    static int score(uint64_t mask) {
+        const int s0 = static_cast<int>(mask & 0x1FFF);
+        const int s1 = static_cast<int>((mask >> 13) & 0x1FFF);
+        const int s2 = static_cast<int>((mask >> 26) & 0x1FFF);
+        const int s3 = static_cast<int>((mask >> 39) & 0x1FFF);
+
+        // Straight flush and flush
+        for (int suitMask : { s0, s1, s2, s3 }) {
+            if (__builtin_popcount(suitMask) < 5)
+                continue;
+            if (int high = straightHigh(suitMask))
+                return FiveCardEvaluator::pack(9, high);
+            int r[5];
+            takeTop(suitMask, r, 5);
+            return FiveCardEvaluator::pack(6, r[0], r[1], r[2], r[3], r[4]);
+        }
+
+        // Ranks held at least once, twice, three times, and four times
+        const int any = s0 | s1 | s2 | s3;
+        const int two = (s0 & s1) | (s0 & s2) | (s0 & s3) | (s1 & s2) | (s1 & s3) | (s2 & s3);
+        const int three = (s0 & s1 & s2) | (s0 & s1 & s3) | (s0 & s2 & s3) | (s1 & s2 & s3);
+        const int four = s0 & s1 & s2 & s3;
+
+        if (four) {
+            int quad = topRank(four);
+            return FiveCardEvaluator::pack(8, quad, topRank(any & ~rankBit(quad)));
+        }
+
+        const int trips = three & ~four;
+        const int pairs = two & ~three;
+        if (trips) {
+            int trip = topRank(trips);
+            int rest = (trips & ~rankBit(trip)) | pairs;
+            if (rest)
+                return FiveCardEvaluator::pack(7, trip, topRank(rest));
+        }
+
+        if (int high = straightHigh(any))
+            return FiveCardEvaluator::pack(5, high);
+
+        int k[5];
+        if (trips) {
+            int trip = topRank(trips);
+            takeTop(any & ~rankBit(trip), k, 2);
+            return FiveCardEvaluator::pack(4, trip, k[0], k[1]);
+        }
+        if (__builtin_popcount(pairs) >= 2) {
+            int high = topRank(pairs);
+            int low = topRank(pairs & ~rankBit(high));
+            return FiveCardEvaluator::pack(3, high, low, topRank(any & ~rankBit(high) & ~rankBit(low)));
+        }
+        if (pairs) {
+            int pair = topRank(pairs);
+            takeTop(any & ~rankBit(pair), k, 3);
+            return FiveCardEvaluator::pack(2, pair, k[0], k[1], k[2]);
+        }
+        takeTop(any, k, 5);
+        return FiveCardEvaluator::pack(1, k[0], k[1], k[2], k[3], k[4]);
+    }
+
+private:
+    // Bit (rank - 2) of a 13-bit rank mask
+    static int rankBit(int rank) {
+        return 1 << (rank - TWO);
+    }
+
+    static int topRank(int rankMask) {
+        return 31 - __builtin_clz(rankMask) + TWO;
+    }
+
+    // Function to take the n highest ranks of a mask, highest first
+    static void takeTop(int rankMask, int* out, int n) {
+        for (int i = 0; i < n; ++i) {
+            out[i] = topRank(rankMask);
+            rankMask &= ~rankBit(out[i]);
+        }
+    }
+
+    // Function to find the highest straight in a rank mask, 0 if none. The
+    // ace is copied below the two so A-2-3-4-5 is found as a 5-high run.
+    static int straightHigh(int rankMask) {
+        int extended = (rankMask << 1) | ((rankMask >> 12) & 1);
+        int runs = extended & (extended >> 1) & (extended >> 2) & (extended >> 3) & (extended >> 4);
+        if (!runs)
+            return 0;
+        return 31 - __builtin_clz(runs) + 5;
+    }
+};
+
+// Structure to hold the outcome counts of an exact enumeration
+struct ExactEquity {
+    long long p1Wins = 0;
+    long long p2Wins = 0;
+    long long ties = 0;
+    long long boards = 0;
+};
+
+// Function to enumerate every runout of a Hold'em spot given as card masks,
+// scoring each board with SevenCardEvaluator
+inline ExactEquity enumerateEquityExact(uint64_t board, uint64_t p1, uint64_t p2) {
+    ExactEquity result;
+    const int cardsToDeal = 5 - __builtin_popcountll(board);
+    if (cardsToDeal < 0)
+        return result;
+    uint64_t deck[52];
+    int deckSize = 0;
+    for (uint64_t rest = ~(board | p1 | p2) & ((uint64_t(1) << 52) - 1); rest; rest &= rest - 1)
+        deck[deckSize++] = rest & (~rest + 1);
+    if (deckSize < cardsToDeal)
+        return result;
+
+    // Indices of the dealt cards, advanced in lexicographic order
+    int dealt[5];
+    for (int c = 0; c < cardsToDeal; ++c) dealt[c] = c;
+    while (true) {
+        uint64_t runout = board;
+        for (int c = 0; c < cardsToDeal; ++c) runout |= deck[dealt[c]];
+        int score1 = SevenCardEvaluator::score(runout | p1);
+        int score2 = SevenCardEvaluator::score(runout | p2);
+        if (score1 > score2) result.p1Wins++;
+        else if (score2 > score1) result.p2Wins++;
+        else result.ties++;
+        result.boards++;
+
+        int c = cardsToDeal - 1;
+        while (c >= 0 && dealt[c] == deckSize - cardsToDeal + c) --c;
+        if (c < 0) break;
+        dealt[c]++;
+        for (int j = c + 1; j < cardsToDeal; ++j) dealt[j] = dealt[j - 1] + 1;
+    }
+    return result;
+}
+
+// Evaluator backends for the Monte Carlo loop; runTrials resolves the backend once and
+// runs a kernel instantiated with that evaluator inlined.
+
+// Enumeration for the evaluator backends
+enum EvaluatorBackend { EVAL_MAP, EVAL_HASH, EVAL_SEVEN, EVAL_BACKEND_COUNT };
+
+// Command-line names of the backends
+inline const char* const EVALUATOR_BACKEND_NAMES[EVAL_BACKEND_COUNT] = { "map", "hash", "seven" };
+
+// Dataset column suffixes of the backends (P1Win_Map, ...)
+inline const char* const EVALUATOR_BACKEND_LABELS[EVAL_BACKEND_COUNT] = { "Map", "Hash", "Seven" };
+
+// Function to convert a backend name to EvaluatorBackend
+inline bool parseEvaluatorBackend(string_view name, EvaluatorBackend& backend) {
+    for (int b = 0; b < EVAL_BACKEND_COUNT; ++b) {
+        if (name == EVALUATOR_BACKEND_NAMES[b]) {
+            backend = static_cast<EvaluatorBackend>(b);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to parse a comma-separated backend list such as "map,hash"
+inline bool parseEvaluatorBackendList(const string& text, vector<EvaluatorBackend>& backends, string& error) {
+    backends.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == string::npos) end = text.size();
+        string_view name = string_view(text).substr(start, end - start);
+        EvaluatorBackend backend;
+        if (!parseEvaluatorBackend(name, backend)) {
+            error = "unknown backend '" + string(name) + "' (expected map, hash or seven)";
+            return false;
+        }
+        if (find(backends.begin(), backends.end(), backend) != backends.end()) {
+            error = "backend '" + string(name) + "' listed twice";
+            return false;
+        }
+        backends.push_back(backend);
+        start = end + 1;
+    }
+    return true;
+}
+
+// Bulk random dealing: eight xoshiro128** generators run side by side so the fill loop
+// vectorises, and their words become unbiased Fisher-Yates picks for a batch of trials.
+
+// BulkRandom class to generate random 32-bit words in bulk
+class BulkRandom {
+public:
+    static constexpr int LANES = 8;
+
+private:
+    uint32_t s0[LANES], s1[LANES], s2[LANES], s3[LANES];
+
+    static uint32_t rotl(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+
+public:
+    explicit BulkRandom(uint64_t seed) {
+        // Each lane's state comes from a splitmix64 sequence, so lanes are decorrelated
+        auto splitmix = [&seed] {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+            };
+        for (int lane = 0; lane < LANES; ++lane) {
+            uint64_t a = splitmix(), b = splitmix();
+            s0[lane] = static_cast<uint32_t>(a);
+            s1[lane] = static_cast<uint32_t>(a >> 32);
+            s2[lane] = static_cast<uint32_t>(b);
+            s3[lane] = static_cast<uint32_t>(b >> 32) | 1; // Never all zero
+        }
+    }
+
+    // Function to fill out with count random words; count must be a multiple of LANES
+    void fill(uint32_t* out, size_t count) {
+        for (size_t i = 0; i < count; i += LANES) {
+            for (int lane = 0; lane < LANES; ++lane) {
+                out[i + lane] = rotl(s1[lane] * 5, 7) * 9;
+                uint32_t t = s1[lane] << 9;
+                s2[lane] ^= s0[lane];
+                s3[lane] ^= s1[lane];
+                s1[lane] ^= s2[lane];
+                s0[lane] ^= s3[lane];
+                s2[lane] ^= t;
+                s3[lane] = rotl(s3[lane], 11);
+            }
+        }
+    }
+};
+
+// BulkCardDealer class to deal cards for batches of trials from bulk random words
+class BulkCardDealer {
+public:
+    // Trials dealt per batch; the kernels size their pick buffers with this
+    static constexpr int BATCH_TRIALS = 256;
+
+private:
+    static constexpr size_t WORDS = 1024;
+
+    BulkRandom random;
+    uint32_t words[WORDS];
+    size_t cursor = WORDS;
+
+    uint32_t nextWord() {
+        if (cursor == WORDS) {
+            random.fill(words, WORDS);
+            cursor = 0;
+        }
+        return words[cursor++];
+    }
+
+    // Function to draw uniformly from [0, bound) given 2^32 mod bound.
+    // Rejected words are rare (under bound in 2^32) and simply replaced.
+    uint32_t below(uint32_t bound, uint32_t threshold) {
+        uint64_t m = static_cast<uint64_t>(nextWord()) * bound;
+        while (static_cast<uint32_t>(m) < threshold)
+            m = static_cast<uint64_t>(nextWord()) * bound;
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+public:
+    explicit BulkCardDealer(uint64_t seed) : random(seed) {}
+
+    // Function to seed from random_device
+    static uint64_t randomSeed() {
+        random_device rd;
+        return (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+
+    // Function to draw a uniform integer in [0, bound)
+    uint32_t below(uint32_t bound) {
+        return below(bound, static_cast<uint32_t>(-bound) % bound);
+    }
+
+    // Function to deal picks for a batch of trials. Pick c of a trial,
+    // picks[t * cardsToDeal + c], is uniform in [c, deckSize): swapping deck
+    // positions c and pick, in order, deals a uniform partial Fisher-Yates.
+    void deal(uint8_t* picks, int trials, int cardsToDeal, int deckSize) {
+        uint32_t bounds[52], thresholds[52];
+        for (int c = 0; c < cardsToDeal; ++c) {
+            bounds[c] = static_cast<uint32_t>(deckSize - c);
+            thresholds[c] = static_cast<uint32_t>(-bounds[c]) % bounds[c];
+        }
+        for (int t = 0; t < trials; ++t) {
+            for (int c = 0; c < cardsToDeal; ++c)
+                *picks++ = static_cast<uint8_t>(c + below(bounds[c], thresholds[c]));
+        }
+    }
+};
+
+// Simulator class to perform Monte Carlo simulations
+class Simulator {
+private:
+    // Trials in the first batch of a budgeted query, and the largest batch after it
+    static constexpr int BUDGET_CALIBRATION_TRIALS = 32;
+    static constexpr int BUDGET_MAX_BATCH = 4096;
+
+    vector<Card> player1Hand;
+    vector<Card> player2Hand;
+    vector<Card> communityCards;
+    GameStage gameStage;
+    HandEvaluator evaluator;
+    EquityCache* cache = nullptr;
+
+public:
+    Simulator(const vector<Card>& p1Hand, const vector<Card>& p2Hand, const string& stage, const vector<Card>& commCards)
+        : player1Hand(p1Hand), player2Hand(p2Hand), communityCards(commCards) {
+        // An unknown stage deals no cards, as the string comparison did
+        if (!parseGameStage(stage, gameStage))
+            gameStage = RIVER;
+    }
+
+    // Function to get all used cards (players' hands and community cards)
+    vector<Card> getAllUsedCards() const {
+        vector<Card> used = player1Hand;
+        used.insert(used.end(), player2Hand.begin(), player2Hand.end());
+        used.insert(used.end(), communityCards.begin(), communityCards.end());
+        return used;
+    }
+
+    // Function to determine how many community cards are needed based on game stage
+    int neededCommunityCards() const {
+        return cardsToDealAt(gameStage);
+    }
+
+    // Function to attach a persistent cache consulted before simulating
+    void setCache(EquityCache* equityCache) {
+        cache = equityCache;
+    }
+
+    // Function to run trials with the given backend, adding the raw outcome
+    // counts and, when categories is given, each player's final hand categories
+    void runTrials(EvaluatorBackend backend, int trials, int& p1Wins, int& p2Wins, int& ties, CategoryHistogram* categories = nullptr) {
+        switch (backend) {
+        case EVAL_MAP:
+            runStageKernel([this](const vector<Card>& hand) { return evaluator.evaluateHandMap(hand); },
+                trials, p1Wins, p2Wins, ties, categories);
+            break;
+        case EVAL_SEVEN:
+            runStageKernel([](const vector<Card>& hand) { return SevenCardEvaluator::score(cardMask(hand)); },
+                trials, p1Wins, p2Wins, ties, categories);
+            break;
+        default:
+            runStageKernel([this](const vector<Card>& hand) { return evaluator.evaluateHandHash(hand); },
+                trials, p1Wins, p2Wins, ties, categories);
+            break;
+        }
+    }
+
+    // Function to run a simulation with the given backend
+    void runSimulation(EvaluatorBackend backend, int trials, double& p1Win, double& p2Win, double& tie, long long& execTime) {
+        long long cachedTrials = 0;
+        if (lookupCache(trials, false, p1Win, p2Win, tie, cachedTrials)) {
+            execTime = 0;
+            return;
+        }
+
+        int p1Wins = 0, p2Wins = 0, ties = 0;
+        auto startTime = chrono::high_resolution_clock::now();
+
+        runTrials(backend, trials, p1Wins, p2Wins, ties);
+
+        auto endTime = chrono::high_resolution_clock::now();
+        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+
+        p1Win = (p1Wins / static_cast<double>(trials)) * 100.0;
+        p2Win = (p2Wins / static_cast<double>(trials)) * 100.0;
+        tie = (ties / static_cast<double>(trials)) * 100.0;
+        storeInCache(p1Wins, p2Wins, ties, trials, false, p1Win, p2Win, tie);
+    }
+
+    // Function to run exact enumeration of every remaining board
+    void runEnumeration(double& p1Win, double& p2Win, double& tie, long long& boards, long long& execTime) {
+        if (lookupCache(0, true, p1Win, p2Win, tie, boards)) {
+            execTime = 0;
+            return;
+        }
+
+        auto startTime = chrono::high_resolution_clock::now();
+        ExactEquity exact = enumerateEquityExact(cardMask(communityCards), cardMask(player1Hand), cardMask(player2Hand));
+        auto endTime = chrono::high_resolution_clock::now();
+        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+
+        boards = exact.boards;
+        p1Win = (exact.p1Wins / static_cast<double>(boards)) * 100.0;
+        p2Win = (exact.p2Wins / static_cast<double>(boards)) * 100.0;
+        tie = (exact.ties / static_cast<double>(boards)) * 100.0;
+        storeInCache(exact.p1Wins, exact.p2Wins, exact.ties, boards, true, p1Win, p2Win, tie);
+    }
+
+    // Function to answer within a wall-clock budget. The river, an exact
+    // cache entry, or an enumeration the budget can afford is answered
+    // exactly; a cached Monte Carlo entry is used when it pools more trials
+    // than the budget could reach; otherwise trials run in batches until
+    // the deadline. A first small batch measures the cost per trial.
+    void runBudgeted(chrono::microseconds budget, BudgetedEquity& result, EvaluatorBackend backend = EVAL_SEVEN) {
+        auto now = [] { return chrono::steady_clock::now(); };
+        auto deadline = now() + budget;
+        long long execTime = 0;
+        result = BudgetedEquity();
+
+        if (lookupCache(0, true, result.p1Win, result.p2Win, result.tie, result.trials)) {
+            result.exact = result.fromCache = true;
+            return;
+        }
+        if (neededCommunityCards() == 0) {
+            runEnumeration(result.p1Win, result.p2Win, result.tie, result.trials, execTime);
+            result.exact = true;
+            return;
+        }
+
+        int p1Wins = 0, p2Wins = 0, ties = 0;
+        long long trials = BUDGET_CALIBRATION_TRIALS;
+        auto calibrationStart = now();
+        runTrials(backend, BUDGET_CALIBRATION_TRIALS, p1Wins, p2Wins, ties);
+        double nanosPerTrial = max(1.0, static_cast<double>(
+            chrono::duration_cast<chrono::nanoseconds>(now() - calibrationStart).count()) / BUDGET_CALIBRATION_TRIALS);
+        auto remainingNanos = [&] {
+            return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(deadline - now()).count());
+            };
+
+        // Enumeration costs about one trial per board
+        if (remainingBoards() * nanosPerTrial <= remainingNanos()) {
+            runEnumeration(result.p1Win, result.p2Win, result.tie, result.trials, execTime);
+            result.exact = true;
+            return;
+        }
+
+        // A precomputed estimate beats anything the budget can reach
+        long long reachable = trials + static_cast<long long>(max(0.0, remainingNanos()) / nanosPerTrial);
+        CachedEquity entry;
+        if (cache && cache->lookup(spotKey(), entry) && entry.trials > 0 &&
+            entry.trials >= static_cast<uint64_t>(reachable)) {
+            double trialsCached = static_cast<double>(entry.trials);
+            result.p1Win = entry.p1Wins / trialsCached * 100.0;
+            result.p2Win = entry.p2Wins / trialsCached * 100.0;
+            result.tie = entry.ties / trialsCached * 100.0;
+            result.trials = static_cast<long long>(entry.trials);
+            result.standardError = equityStandardError(entry.p1Wins / trialsCached, entry.ties / trialsCached, result.trials) * 100.0;
+            result.fromCache = true;
+            return;
+        }
+
+        // Batches take half the remaining time, so the last one cannot overrun by much
+        while (true) {
+            double left = remainingNanos();
+            int batch = static_cast<int>(min(static_cast<double>(BUDGET_MAX_BATCH), left / 2.0 / nanosPerTrial));
+            if (batch < 1)
+                break;
+            auto batchStart = now();
+            runTrials(backend, batch, p1Wins, p2Wins, ties);
+            trials += batch;
+            double measured = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(now() - batchStart).count()) / batch;
+            nanosPerTrial = max(1.0, (nanosPerTrial + measured) / 2.0);
+        }
+
+        result.trials = trials;
+        result.p1Win = p1Wins / static_cast<double>(trials) * 100.0;
+        result.p2Win = p2Wins / static_cast<double>(trials) * 100.0;
+        result.tie = ties / static_cast<double>(trials) * 100.0;
+        result.standardError = equityStandardError(p1Wins / static_cast<double>(trials), ties / static_cast<double>(trials), trials) * 100.0;
+        // Pool into the cache, but report this run's estimate so it matches trials and standard error
+        double pooledP1 = 0.0, pooledP2 = 0.0, pooledTie = 0.0;
+        storeInCache(p1Wins, p2Wins, ties, trials, false, pooledP1, pooledP2, pooledTie);
+    }
+
+    // Function to count the runouts left to deal, C(remaining cards, cards to deal)
+    long long remainingBoards() const {
+        long long remaining = 52 - static_cast<long long>(getAllUsedCards().size());
+        long long boards = 1;
+        for (int c = 0; c < neededCommunityCards(); ++c)
+            boards = boards * (remaining - c) / (c + 1);
+        return boards;
+    }
+
+    // Function to get the canonical cache key of this spot
+    SpotKey spotKey() const {
+        return canonicalSpot(cardMask(communityCards), cardMask(player1Hand), cardMask(player2Hand));
+    }
+
+private:
+    // Function to answer from the cache: an exact entry always does, a Monte
+    // Carlo entry only when it pools at least minTrials trials
+    bool lookupCache(long long minTrials, bool needExact, double& p1Win, double& p2Win, double& tie, long long& trials) const {
+        CachedEquity entry;
+        if (!cache || !cache->lookup(spotKey(), entry))
+            return false;
+        if (!entry.exact && (needExact || entry.trials < static_cast<uint64_t>(minTrials) || entry.trials == 0))
+            return false;
+        p1Win = (entry.p1Wins / static_cast<double>(entry.trials)) * 100.0;
+        p2Win = (entry.p2Wins / static_cast<double>(entry.trials)) * 100.0;
+        tie = (entry.ties / static_cast<double>(entry.trials)) * 100.0;
+        trials = static_cast<long long>(entry.trials);
+        return true;
+    }
+
+    // Function to merge a result into the cache and report the pooled estimate
+    void storeInCache(long long p1Wins, long long p2Wins, long long ties, long long trials, bool exact,
+        double& p1Win, double& p2Win, double& tie) {
+        if (!cache || trials <= 0)
+            return;
+        CachedEquity add;
+        add.p1Wins = static_cast<uint64_t>(p1Wins);
+        add.p2Wins = static_cast<uint64_t>(p2Wins);
+        add.ties = static_cast<uint64_t>(ties);
+        add.trials = static_cast<uint64_t>(trials);
+        add.exact = exact;
+        CachedEquity merged;
+        if (!cache->merge(spotKey(), add, merged) || merged.trials == 0)
+            return;
+        p1Win = (merged.p1Wins / static_cast<double>(merged.trials)) * 100.0;
+        p2Win = (merged.p2Wins / static_cast<double>(merged.trials)) * 100.0;
+        tie = (merged.ties / static_cast<double>(merged.trials)) * 100.0;
+    }
+
+    // Function to dispatch to the kernel compiled for this stage, with or
+    // without category counting
+    template<typename Evaluate>
+    void runStageKernel(Evaluate evaluate, int trials, int& p1Wins, int& p2Wins, int& ties, CategoryHistogram* categories) {
+        if (categories) runStageKernel<true>(evaluate, trials, p1Wins, p2Wins, ties, *categories);
+        else {
+            CategoryHistogram unused;
+            runStageKernel<false>(evaluate, trials, p1Wins, p2Wins, ties, unused);
+        }
+    }
+
+    template<bool CountCategories, typename Evaluate>
+    void runStageKernel(Evaluate evaluate, int trials, int& p1Wins, int& p2Wins, int& ties, CategoryHistogram& categories) {
+        switch (gameStage) {
+        case PREFLOP: runKernel<5, CountCategories>(evaluate, trials, p1Wins, p2Wins, ties, categories); break;
+        case FLOP: runKernel<2, CountCategories>(evaluate, trials, p1Wins, p2Wins, ties, categories); break;
+        case TURN: runKernel<1, CountCategories>(evaluate, trials, p1Wins, p2Wins, ties, categories); break;
+        default: runKernel<0, CountCategories>(evaluate, trials, p1Wins, p2Wins, ties, categories); break;
+        }
+    }
+
+    // Trial loop for a fixed number of cards to deal. The remaining deck is
+    // built once per run, and each trial deals by partial Fisher-Yates, with
+    // picks drawn in bulk per batch, straight into preallocated hand buffers.
+    // Categories are counted into a local histogram, owned by the calling
+    // thread, and added to the caller's once at the end.
+    template<int CardsToDeal, bool CountCategories, typename Evaluate>
+    void runKernel(Evaluate evaluate, int trials, int& p1Wins, int& p2Wins, int& ties, CategoryHistogram& categories) {
+        CategoryHistogram local;
+        // Hand buffers: hole cards, known community cards, then dealt cards
+        vector<Card> p1Total = player1Hand;
+        p1Total.insert(p1Total.end(), communityCards.begin(), communityCards.end());
+        vector<Card> p2Total = player2Hand;
+        p2Total.insert(p2Total.end(), communityCards.begin(), communityCards.end());
+
+        if constexpr (CardsToDeal == 0) {
+            // The river needs no simulation: every trial has the same outcome
+            auto hv1 = evaluate(p1Total);
+            auto hv2 = evaluate(p2Total);
+            if (hv1 > hv2) p1Wins += trials;
+            else if (hv2 > hv1) p2Wins += trials;
+            else ties += trials;
+            if constexpr (CountCategories) {
+                local.counts[0][handCategory(hv1) - 1] += trials;
+                local.counts[1][handCategory(hv2) - 1] += trials;
+            }
+        }
+        else {
+            Deck deck(getAllUsedCards());
+            const int deckSize = static_cast<int>(deck.cards.size());
+            if (deckSize < CardsToDeal) return; // Safety check
+
+            const size_t p1Base = p1Total.size();
+            const size_t p2Base = p2Total.size();
+            p1Total.resize(p1Base + CardsToDeal, deck.cards[0]);
+            p2Total.resize(p2Base + CardsToDeal, deck.cards[0]);
+
+            // Picks for a batch of trials are drawn up front, off the trial loop's critical path
+            BulkCardDealer dealer(BulkCardDealer::randomSeed());
+            uint8_t picks[BulkCardDealer::BATCH_TRIALS * CardsToDeal];
+
+            for (int done = 0; done < trials; done += BulkCardDealer::BATCH_TRIALS) {
+                int batch = min(BulkCardDealer::BATCH_TRIALS, trials - done);
+                dealer.deal(picks, batch, CardsToDeal, deckSize);
+                const uint8_t* trialPicks = picks;
+                for (int i = 0; i < batch; ++i, trialPicks += CardsToDeal) {
+                    dealCards(make_index_sequence<CardsToDeal>(), deck.cards.data(), trialPicks,
+                        p1Total.data() + p1Base, p2Total.data() + p2Base);
+
+                    auto hv1 = evaluate(p1Total);
+                    auto hv2 = evaluate(p2Total);
+
+                    // Compare hands
+                    if (hv1 > hv2) p1Wins++;
+                    else if (hv2 > hv1) p2Wins++;
+                    else ties++;
+                    if constexpr (CountCategories) {
+                        local.counts[0][handCategory(hv1) - 1]++;
+                        local.counts[1][handCategory(hv2) - 1]++;
+                    }
+                }
+            }
+        }
+        if constexpr (CountCategories) categories.add(local);
+    }
+
+    // Function to deal the cards of one trial, unrolled at compile time
+    template<size_t... Dealt>
+    static void dealCards(index_sequence<Dealt...>, Card* deck, const uint8_t* picks, Card* p1Out, Card* p2Out) {
+        (dealCard(static_cast<int>(Dealt), deck, picks, p1Out, p2Out), ...);
+    }
+
+    // Function to swap the picked undealt card into position c and deal it
+    static void dealCard(int c, Card* deck, const uint8_t* picks, Card* p1Out, Card* p2Out) {
+        swap(deck[c], deck[picks[c]]);
+        p1Out[c] = deck[c];
+        p2Out[c] = deck[c];
+    }
+};
+
+// Omaha hands play exactly two hole cards with exactly three community cards; hole
+// pairs and board triples are summarised once and each pairing is scored with integers.
+
+// OmahaSimulator class to compute equity between two four-card hands
+class OmahaSimulator {
+private:
+    struct HolePair {
+        int r0, r1;
+        int suit; // -1 when the two cards differ in suit
+    };
+
+    struct BoardTriple {
+        int r0, r1, r2;
+        int suit; // -1 unless all three share a suit
+    };
+
+    vector<Card> player1Hand;
+    vector<Card> player2Hand;
+    vector<Card> communityCards;
+    GameStage gameStage;
+
+public:
+    OmahaSimulator(const vector<Card>& p1Hand, const vector<Card>& p2Hand, const string& stage, const vector<Card>& commCards)
+        : player1Hand(p1Hand), player2Hand(p2Hand), communityCards(commCards) {
+        if (!parseGameStage(stage, gameStage))
+            gameStage = RIVER;
+    }
+
+    int neededCommunityCards() const {
+        return cardsToDealAt(gameStage);
+    }
+
+    // Function to run a Monte Carlo simulation
+    void runSimulation(int trials, double& p1Win, double& p2Win, double& tie, long long& execTime) {
+        long long p1Wins = 0, p2Wins = 0, ties = 0;
+        auto startTime = chrono::high_resolution_clock::now();
+
+        HolePair p1Pairs[6], p2Pairs[6];
+        summarisePairs(player1Hand, p1Pairs);
+        summarisePairs(player2Hand, p2Pairs);
+
+        const int known = static_cast<int>(communityCards.size());
+        const int cardsToDeal = neededCommunityCards();
+        vector<Card> board = communityCards;
+        Deck deck(getAllUsedCards());
+        const int deckSize = static_cast<int>(deck.cards.size());
+
+        if (cardsToDeal == 0 || deckSize < cardsToDeal) {
+            // Nothing to deal: every trial has the same outcome
+            countBoard(board.data(), p1Pairs, p2Pairs, p1Wins, p2Wins, ties);
+            p1Wins *= trials;
+            p2Wins *= trials;
+            ties *= trials;
+        }
+        else {
+            board.resize(known + cardsToDeal, deck.cards[0]);
+            BulkCardDealer dealer(BulkCardDealer::randomSeed());
+            vector<uint8_t> picks(static_cast<size_t>(BulkCardDealer::BATCH_TRIALS) * cardsToDeal);
+            for (int done = 0; done < trials; done += BulkCardDealer::BATCH_TRIALS) {
+                int batch = min(BulkCardDealer::BATCH_TRIALS, trials - done);
+                dealer.deal(picks.data(), batch, cardsToDeal, deckSize);
+                const uint8_t* pick = picks.data();
+                for (int i = 0; i < batch; ++i) {
+                    // Partial Fisher-Yates: the first cardsToDeal deck cards are the runout
+                    for (int c = 0; c < cardsToDeal; ++c) {
+                        swap(deck.cards[c], deck.cards[*pick++]);
+                        board[known + c] = deck.cards[c];
+                    }
+                    countBoard(board.data(), p1Pairs, p2Pairs, p1Wins, p2Wins, ties);
+                }
+            }
+        }
+
+        auto endTime = chrono::high_resolution_clock::now();
+        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+
+        p1Win = (p1Wins / static_cast<double>(trials)) * 100.0;
+        p2Win = (p2Wins / static_cast<double>(trials)) * 100.0;
+        tie = (ties / static_cast<double>(trials)) * 100.0;
+    }
+
+    // Function to run exact enumeration of every remaining board
+    void runEnumeration(double& p1Win, double& p2Win, double& tie, long long& boards, long long& execTime) {
+        long long p1Wins = 0, p2Wins = 0, ties = 0;
+        auto startTime = chrono::high_resolution_clock::now();
+
+        HolePair p1Pairs[6], p2Pairs[6];
+        summarisePairs(player1Hand, p1Pairs);
+        summarisePairs(player2Hand, p2Pairs);
+
+        const int known = static_cast<int>(communityCards.size());
+        const int cardsToDeal = neededCommunityCards();
+        Deck deck(getAllUsedCards());
+        const int deckSize = static_cast<int>(deck.cards.size());
+        vector<Card> board = communityCards;
+        board.resize(known + cardsToDeal, deck.cards[0]);
+
+        // Indices of the dealt cards, advanced in lexicographic order
+        vector<int> dealt(cardsToDeal);
+        for (int c = 0; c < cardsToDeal; ++c) dealt[c] = c;
+
+        boards = 0;
+        while (true) {
+            for (int c = 0; c < cardsToDeal; ++c) board[known + c] = deck.cards[dealt[c]];
+            countBoard(board.data(), p1Pairs, p2Pairs, p1Wins, p2Wins, ties);
+            boards++;
+
+            // Advance to the next combination
+            int c = cardsToDeal - 1;
+            while (c >= 0 && dealt[c] == deckSize - cardsToDeal + c) --c;
+            if (c < 0) break;
+            dealt[c]++;
+            for (int j = c + 1; j < cardsToDeal; ++j) dealt[j] = dealt[j - 1] + 1;
+        }
+
+        auto endTime = chrono::high_resolution_clock::now();
+        execTime = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+
+        p1Win = (p1Wins / static_cast<double>(boards)) * 100.0;
+        p2Win = (p2Wins / static_cast<double>(boards)) * 100.0;
+        tie = (ties / static_cast<double>(boards)) * 100.0;
+    }
+
+private:
+    vector<Card> getAllUsedCards() const {
+        vector<Card> used = player1Hand;
+        used.insert(used.end(), player2Hand.begin(), player2Hand.end());
+        used.insert(used.end(), communityCards.begin(), communityCards.end());
+        return used;
+    }
+
+    // Function to summarise the 6 two-card subsets of a four-card hand
+    static void summarisePairs(const vector<Card>& hand, HolePair out[6]) {
+        int n = 0;
+        for (int i = 0; i < 4; ++i)
+            for (int j = i + 1; j < 4; ++j)
+                out[n++] = { hand[i].rank, hand[j].rank, hand[i].suit == hand[j].suit ? hand[i].suit : -1 };
+    }
+
+    // Function to score both players on one complete five-card board
+    static void countBoard(const Card* board, const HolePair p1Pairs[6], const HolePair p2Pairs[6],
+        long long& p1Wins, long long& p2Wins, long long& ties) {
+        // The 10 three-card subsets of the board, shared by both players
+        BoardTriple triples[10];
+        int n = 0;
+        for (int i = 0; i < 5; ++i)
+            for (int j = i + 1; j < 5; ++j)
+                for (int k = j + 1; k < 5; ++k) {
+                    bool suited = board[i].suit == board[j].suit && board[j].suit == board[k].suit;
+                    triples[n++] = { board[i].rank, board[j].rank, board[k].rank, suited ? board[i].suit : -1 };
+                }
+
+        int score1 = bestScore(p1Pairs, triples);
+        int score2 = bestScore(p2Pairs, triples);
+        if (score1 > score2) p1Wins++;
+        else if (score2 > score1) p2Wins++;
+        else ties++;
+    }
+
+    static int bestScore(const HolePair pairs[6], const BoardTriple triples[10]) {
+        int best = 0;
+        for (int p = 0; p < 6; ++p) {
+            const HolePair& pair = pairs[p];
+            for (int t = 0; t < 10; ++t) {
+                const BoardTriple& triple = triples[t];
+                bool flush = pair.suit >= 0 && pair.suit == triple.suit;
+                int score = FiveCardEvaluator::score(pair.r0, pair.r1, triple.r0, triple.r1, triple.r2, flush);
+                if (score > best) best = score;
+            }
+        }
+        return best;
+    }
+};
+
+// With the full board known every two-card hand has a fixed strength, so hands are
+// ranked once and range questions become prefix-sum lookups corrected for blockers.
+
+// Structure to represent win/tie/loss weight of a hand against a range
+struct RangeOutcome {
+    double wins = 0.0;
+    double ties = 0.0;
+    double losses = 0.0;
+
+    // Function to get the equity share, counting ties as half
+    double equity() const {
+        double total = wins + ties + losses;
+        return total > 0.0 ? (wins + ties / 2.0) / total : 0.0;
+    }
+};
+
+// RiverRanking class to rank every hole-card pair on a fixed five-card board
+class RiverRanking {
+public:
+    // Structure to represent one hole-card pair (card indices, first < second)
+    struct Combo {
+        int first;
+        int second;
+        int score;
+    };
+
+    // Number of hole-card pairs over the whole deck, the size of a range
+    static constexpr int COMBO_SPACE = 1326;
+
+    explicit RiverRanking(const vector<Card>& board) : boardMask(cardMask(board)) {
+        for (int i = 0; i < COMBO_SPACE; ++i) position[i] = -1;
+        for (int a = 0; a < 52; ++a) {
+            if (boardMask >> a & 1) continue;
+            for (int b = a + 1; b < 52; ++b) {
+                if (boardMask >> b & 1) continue;
+                uint64_t mask = boardMask | (1ULL << a) | (1ULL << b);
+                combos.push_back({ a, b, SevenCardEvaluator::score(mask) });
+            }
+        }
+        sort(combos.begin(), combos.end(), [](const Combo& x, const Combo& y) {
+            return x.score < y.score;
+            });
+
+        // Position of each pair in the ranking, and the bounds of its tie group
+        groupStart.resize(combos.size());
+        groupEnd.resize(combos.size());
+        for (size_t i = 0; i < combos.size(); ++i) {
+            position[comboIndex(combos[i].first, combos[i].second)] = static_cast<int>(i);
+            groupStart[i] = (i > 0 && combos[i - 1].score == combos[i].score) ? groupStart[i - 1] : static_cast<int>(i);
+        }
+        for (size_t i = combos.size(); i-- > 0;) {
+            groupEnd[i] = (i + 1 < combos.size() && combos[i + 1].score == combos[i].score) ? groupEnd[i + 1] : static_cast<int>(i) + 1;
+        }
+        setUniformRange();
+    }
+
+    // Function to get the hands from weakest to strongest
+    const vector<Combo>& ranking() const {
+        return combos;
+    }
+
+    // Function to number a pair of card indices 0-1325, independent of the board
+    static int comboIndex(int a, int b) {
+        if (a > b) swap(a, b);
+        return a * (103 - a) / 2 + (b - a - 1);
+    }
+
+    // Function to get a pair's position in the ranking, -1 if it uses a board card
+    int positionOf(int a, int b) const {
+        if (a == b || a < 0 || b < 0 || a >= 52 || b >= 52)
+            return -1;
+        return position[comboIndex(a, b)];
+    }
+
+    // Function to compare two pairs: 1 when the first wins, -1 when it loses, 0 on a tie
+    int compare(int a1, int a2, int b1, int b2) const {
+        int p1 = positionOf(a1, a2);
+        int p2 = positionOf(b1, b2);
+        if (p1 < 0 || p2 < 0)
+            return 0;
+        return combos[p1].score > combos[p2].score ? 1 : (combos[p1].score < combos[p2].score ? -1 : 0);
+    }
+
+    // Function to set the range weights, indexed by comboIndex; pairs that
+    // use a board card are ignored
+    void setRange(const vector<double>& weights) {
+        prefix.assign(combos.size() + 1, 0.0);
+        rangeWeight.assign(combos.size(), 0.0);
+        for (size_t i = 0; i < combos.size(); ++i) {
+            int index = comboIndex(combos[i].first, combos[i].second);
+            rangeWeight[i] = index < static_cast<int>(weights.size()) ? weights[index] : 0.0;
+            prefix[i + 1] = prefix[i] + rangeWeight[i];
+        }
+    }
+
+    // Function to weight every hand equally, i.e. a random opponent
+    void setUniformRange() {
+        setRange(vector<double>(COMBO_SPACE, 1.0));
+    }
+
+    // Function to score a pair against the current range
+    RangeOutcome versusRange(int a, int b) const {
+        RangeOutcome outcome;
+        int p = positionOf(a, b);
+        if (p < 0)
+            return outcome;
+        outcome.wins = prefix[groupStart[p]];
+        outcome.ties = prefix[groupEnd[p]] - prefix[groupStart[p]];
+        outcome.losses = prefix[combos.size()] - prefix[groupEnd[p]];
+
+        // Blocker correction: remove the range hands that hold one of the
+        // hero's cards, and the hero's own pair
+        auto remove = [&](int q) {
+            if (q < 0) return;
+            if (combos[q].score < combos[p].score) outcome.wins -= rangeWeight[q];
+            else if (combos[q].score > combos[p].score) outcome.losses -= rangeWeight[q];
+            else outcome.ties -= rangeWeight[q];
+            };
+        for (int other = 0; other < 52; ++other) {
+            if (other == a || other == b) continue;
+            remove(positionOf(a, other));
+            remove(positionOf(b, other));
+        }
+        remove(p);
+        return outcome;
+    }
+
+private:
+    uint64_t boardMask;
+    vector<Combo> combos;
+    int position[COMBO_SPACE];
+    vector<int> groupStart;
+    vector<int> groupEnd;
+    vector<double> rangeWeight;
+    vector<double> prefix;
+};
+
+// Equity against 1-9 unknown opponents, by Monte Carlo or, on the turn and river
+// while MAX_EXACT_DEALS allows, by exact enumeration.
+
+// Structure to represent the hero's result against random opponents
+struct MultiwayEquity {
+    double win = 0.0;    // % of deals the hero wins outright
+    double tie = 0.0;    // % of deals the hero shares the best hand
+    double lose = 0.0;   // % of deals some opponent has a better hand
+    double equity = 0.0; // % of the pot the hero wins on average, split pots shared
+    long long samples = 0; // Trials run, or deals enumerated
+    bool exact = false;
+};
+
+// MultiwaySimulator class to compute equity against random opponents
+class MultiwaySimulator {
+public:
+    static constexpr int MAX_OPPONENTS = 9;
+    static constexpr long long MAX_EXACT_DEALS = 200000000;
+
+private:
+    uint64_t heroMask;
+    uint64_t boardMask;
+    int boardCount;
+    int opponents;
+
+    // Structure to represent an opponent hand that does not beat the hero
+    struct Holding {
+        uint64_t mask;
+        bool ties;
+    };
+
+    // Sums over the opponent sets of one runout
+    struct SetTotals {
+        double wins = 0.0;
+        double ties = 0.0;
+        double share = 0.0;
+    };
+
+public:
+    MultiwaySimulator(const vector<Card>& heroHand, const vector<Card>& board, int numOpponents)
+        : heroMask(cardMask(heroHand)), boardMask(cardMask(board)), boardCount(static_cast<int>(board.size())),
+        opponents(max(1, min(MAX_OPPONENTS, numOpponents))) {}
+
+    int neededCommunityCards() const {
+        return 5 - boardCount;
+    }
+
+    // Function to count the deals an exact answer would cover: runouts times
+    // opponent sets; -1 when it is too large to count
+    long long exactDeals() const {
+        int needed = neededCommunityCards();
+        int remaining = 52 - 2 - boardCount;
+        if (needed > 1 || remaining - needed < 2 * opponents) return -1;
+        double deals = needed == 1 ? remaining : 1;
+        deals *= opponentSets(remaining - needed, opponents);
+        return deals > static_cast<double>(MAX_EXACT_DEALS) * 1000.0 ? -1 : static_cast<long long>(deals);
+    }
+
+    // Function to check whether the exact path is available for this spot
+    bool canEnumerate() const {
+        long long deals = exactDeals();
+        return deals >= 0 && deals <= MAX_EXACT_DEALS;
+    }
+
+    // Function to run a Monte Carlo simulation
+    void runSimulation(int trials, MultiwayEquity& result, long long& execTime) {
+        auto startTime = chrono::high_resolution_clock::now();
+        result = MultiwayEquity();
+        const int needed = neededCommunityCards();
+        const int cardsToDeal = needed + 2 * opponents;
+        uint64_t deck[52];
+        int deckSize = 0;
+        for (int c = 0; c < 52; ++c) {
+            uint64_t bit = uint64_t(1) << c;
+            if (!((heroMask | boardMask) & bit)) deck[deckSize++] = bit;
+        }
+
+        long long wins = 0, ties = 0;
+        double share = 0.0;
+        if (deckSize >= cardsToDeal && trials > 0) {
+            BulkCardDealer dealer(BulkCardDealer::randomSeed());
+            vector<uint8_t> picks(static_cast<size_t>(BulkCardDealer::BATCH_TRIALS) * cardsToDeal);
+            for (int done = 0; done < trials; done += BulkCardDealer::BATCH_TRIALS) {
+                int batch = min(BulkCardDealer::BATCH_TRIALS, trials - done);
+                dealer.deal(picks.data(), batch, cardsToDeal, deckSize);
+                const uint8_t* pick = picks.data();
+                for (int i = 0; i < batch; ++i, pick += cardsToDeal) {
+                    for (int c = 0; c < cardsToDeal; ++c) swap(deck[c], deck[pick[c]]);
+                    uint64_t runout = boardMask;
+                    for (int c = 0; c < needed; ++c) runout |= deck[c];
+
+                    // The hero is scored once per runout; the first better opponent settles the trial
+                    int heroScore = SevenCardEvaluator::score(runout | heroMask);
+                    int tiedWith = 0;
+                    bool lost = false;
+                    for (int o = 0; o < opponents && !lost; ++o) {
+                        uint64_t hole = deck[needed + 2 * o] | deck[needed + 2 * o + 1];
+                        int score = SevenCardEvaluator::score(runout | hole);
+                        if (score > heroScore) lost = true;
+                        else if (score == heroScore) tiedWith++;
+                    }
+                    if (lost) continue;
+                    if (tiedWith == 0) wins++;
+                    else ties++;
+                    share += 1.0 / (tiedWith + 1);
+                }
+            }
+        }
+
+        double total = max(trials, 1);
+        result.win = wins / total * 100.0;
+        result.tie = ties / total * 100.0;
+        result.lose = 100.0 - result.win - result.tie;
+        result.equity = share / total * 100.0;
+        result.samples = trials;
+        execTime = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - startTime).count();
+    }
+
+    // Function to compute the exact result on the turn or river; returns
+    // false (leaving result untouched) when canEnumerate() is false
+    bool runEnumeration(MultiwayEquity& result, long long& execTime) {
+        if (!canEnumerate()) return false;
+        auto startTime = chrono::high_resolution_clock::now();
+        const int needed = neededCommunityCards();
+        uint64_t dead = heroMask | boardMask;
+
+        SetTotals sum;
+        int runouts = 0;
+        for (int r = 0; r < 52; ++r) {
+            uint64_t river = needed == 1 ? uint64_t(1) << r : 0;
+            if (needed == 1 && (dead & river)) continue;
+            if (needed == 0 && r > 0) break;
+            SetTotals runoutTotals = enumerateRunout(boardMask | river, dead | river);
+            sum.wins += runoutTotals.wins;
+            sum.ties += runoutTotals.ties;
+            sum.share += runoutTotals.share;
+            runouts++;
+        }
+
+        // Every runout has the same number of opponent sets
+        int available = 52 - 2 - 5;
+        double sets = opponentSets(available, opponents) * runouts;
+        result = MultiwayEquity();
+        result.win = sum.wins / sets * 100.0;
+        result.tie = sum.ties / sets * 100.0;
+        result.lose = 100.0 - result.win - result.tie;
+        result.equity = sum.share / sets * 100.0;
+        result.samples = static_cast<long long>(sets);
+        result.exact = true;
+        execTime = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - startTime).count();
+        return true;
+    }
+
+private:
+    // Function to count the ways to seat n unordered opponents from m cards:
+    // m! / ((m - 2n)! 2^n n!)
+    static double opponentSets(int m, int n) {
+        double sets = 1.0;
+        for (int i = 0; i < n; ++i)
+            sets *= (m - 2 * i) * (m - 2 * i - 1) / 2.0;
+        for (int i = 2; i <= n; ++i) sets /= i;
+        return sets;
+    }
+
+    // Function to total every set of disjoint opponent hands on a full board
+    // in which nobody beats the hero
+    SetTotals enumerateRunout(uint64_t board, uint64_t dead) const {
+        int heroScore = SevenCardEvaluator::score(board | heroMask);
+        vector<Holding> holdings;
+        for (int a = 0; a < 52; ++a) {
+            if (dead >> a & 1) continue;
+            for (int b = a + 1; b < 52; ++b) {
+                if (dead >> b & 1) continue;
+                uint64_t hole = (uint64_t(1) << a) | (uint64_t(1) << b);
+                int score = SevenCardEvaluator::score(board | hole);
+                if (score <= heroScore) holdings.push_back({ hole, score == heroScore });
+            }
+        }
+        SetTotals totals;
+        addSets(holdings, 0, 0, opponents, 0, totals);
+        return totals;
+    }
+
+    // Function to extend a partial set with holdings after index start
+    static void addSets(const vector<Holding>& holdings, size_t start, uint64_t used, int left, int tiedWith, SetTotals& totals) {
+        if (left == 0) {
+            if (tiedWith == 0) totals.wins += 1.0;
+            else totals.ties += 1.0;
+            totals.share += 1.0 / (tiedWith + 1);
+            return;
+        }
+        for (size_t i = start; i < holdings.size(); ++i) {
+            if (holdings[i].mask & used) continue;
+            addSets(holdings, i + 1, used | holdings[i].mask, left - 1, tiedWith + (holdings[i].ties ? 1 : 0), totals);
+        }
+    }
+};
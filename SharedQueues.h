@@ -0,0 +1,223 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <sys/mman.h>
+
+using namespace std;
+
+// Queues for processes sharing a memory mapping created before fork(): SharedMpmcRing
+// for small POD items and SharedByteRing for byte messages from one producer.
+
+static_assert(atomic<uint64_t>::is_always_lock_free, "shared-memory queues need lock-free 64-bit atomics");
+
+// Bounded lock-free MPMC ring of trivially copyable items; Capacity must be a power of two
+template<typename T, size_t Capacity>
+struct SharedMpmcRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    struct alignas(64) Cell {
+        atomic<uint64_t> sequence;
+        T value;
+    };
+
+    static constexpr uint64_t NO_CLAIM = ~uint64_t(0);
+
+    Cell cells[Capacity];
+    alignas(64) atomic<uint64_t> enqueuePos;
+    alignas(64) atomic<uint64_t> dequeuePos;
+
+    void init() {
+        for (size_t i = 0; i < Capacity; ++i)
+            cells[i].sequence.store(i, memory_order_relaxed);
+        enqueuePos.store(0, memory_order_relaxed);
+        dequeuePos.store(0, memory_order_relaxed);
+    }
+
+    // Function to get the number of queued items (approximate while in use)
+    size_t size() const {
+        uint64_t tail = enqueuePos.load(memory_order_relaxed);
+        uint64_t head = dequeuePos.load(memory_order_relaxed);
+        return tail > head ? static_cast<size_t>(tail - head) : 0;
+    }
+
+    bool tryPush(const T& value) {
+        uint64_t pos = enqueuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & (Capacity - 1)];
+            uint64_t sequence = cell.sequence.load(memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Full
+            }
+            else {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        uint64_t pos = dequeuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & (Capacity - 1)];
+            uint64_t sequence = cell.sequence.load(memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.sequence.store(pos + Capacity, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Empty
+            }
+            else {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Function to pop like tryPop, first announcing in claim (a location the
+    // consumer owns, e.g. in shared memory) the position it is about to take,
+    // so releaseClaim can recover the item if the consumer dies mid-pop
+    bool tryPop(T& value, atomic<uint64_t>& claim) {
+        uint64_t pos = dequeuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & (Capacity - 1)];
+            uint64_t sequence = cell.sequence.load(memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos + 1);
+            if (diff == 0) {
+                claim.store(pos, memory_order_seq_cst);
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_seq_cst, memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.sequence.store(pos + Capacity, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Empty
+            }
+            else {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Function to release the cell a dead consumer announced, if it was
+    // claimed and never released; its item is passed to onItem. Cells are
+    // only reset when no live consumer has announced the same position
+    // (announcedByLive(pos) is false), since that consumer may be the one
+    // that won the claim and is about to read the cell. Returns false if
+    // such a consumer still holds the announcement after a short wait (it
+    // may itself have died unnoticed); call again once it is reaped.
+    template<typename Live, typename F>
+    bool releaseClaim(uint64_t pos, Live&& announcedByLive, F&& onItem) {
+        if (pos == NO_CLAIM) return true;
+        Cell& cell = cells[pos & (Capacity - 1)];
+        for (int spin = 0;; ++spin) {
+            if (cell.sequence.load(memory_order_acquire) != pos + 1) return true; // Released, or never claimed
+            if (dequeuePos.load(memory_order_seq_cst) <= pos) return true;          // Not claimed yet
+            if (!announcedByLive(pos)) break;
+            if (spin == 1 << 14) return false;
+            this_thread::yield(); // A live consumer either owns it or is about to move on
+        }
+        onItem(cell.value);
+        cell.sequence.store(pos + Capacity, memory_order_release);
+        return true;
+    }
+};
+
+// Single-producer single-consumer ring of variable-length messages. Each
+// message is a fixed header followed by a payload; the write position is
+// only advanced once both are in place, so a producer that dies mid-write
+// leaves nothing half-written for the consumer.
+template<size_t Capacity>
+struct SharedByteRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    alignas(64) atomic<uint64_t> writePos;
+    alignas(64) atomic<uint64_t> readPos;
+    alignas(64) char data[Capacity];
+
+    void init() {
+        writePos.store(0, memory_order_relaxed);
+        readPos.store(0, memory_order_relaxed);
+    }
+
+    // Largest payload a message can carry with the given header
+    template<typename Header>
+    static constexpr size_t maxPayload() {
+        return Capacity / 2 - sizeof(uint32_t) - sizeof(Header);
+    }
+
+    // Function to append a message; false while there is not enough room
+    template<typename Header>
+    bool tryWrite(const Header& header, const char* payload, uint32_t length) {
+        uint64_t pos = writePos.load(memory_order_relaxed);
+        uint64_t needed = sizeof(uint32_t) + sizeof(Header) + length;
+        if (needed > Capacity / 2 || pos + needed - readPos.load(memory_order_acquire) > Capacity)
+            return false;
+        copyIn(pos, &length, sizeof(length));
+        copyIn(pos + sizeof(length), &header, sizeof(Header));
+        copyIn(pos + sizeof(length) + sizeof(Header), payload, length);
+        writePos.store(pos + needed, memory_order_release);
+        return true;
+    }
+
+    // Function to take the next message; false when the ring is empty
+    template<typename Header>
+    bool tryRead(Header& header, string& payload) {
+        uint64_t pos = readPos.load(memory_order_relaxed);
+        if (pos == writePos.load(memory_order_acquire))
+            return false;
+        uint32_t length;
+        copyOut(pos, &length, sizeof(length));
+        copyOut(pos + sizeof(length), &header, sizeof(Header));
+        payload.resize(length);
+        copyOut(pos + sizeof(length) + sizeof(Header), &payload[0], length);
+        readPos.store(pos + sizeof(length) + sizeof(Header) + length, memory_order_release);
+        return true;
+    }
+
+private:
+    void copyIn(uint64_t pos, const void* source, size_t length) {
+        size_t offset = static_cast<size_t>(pos & (Capacity - 1));
+        size_t first = min(length, Capacity - offset);
+        memcpy(data + offset, source, first);
+        memcpy(data, static_cast<const char*>(source) + first, length - first);
+    }
+
+    void copyOut(uint64_t pos, void* target, size_t length) const {
+        size_t offset = static_cast<size_t>(pos & (Capacity - 1));
+        size_t first = min(length, Capacity - offset);
+        memcpy(target, data + offset, first);
+        memcpy(static_cast<char*>(target) + first, data, length - first);
+    }
+};
+
+// Function to allocate a zeroed T in memory shared with processes forked
+// afterwards; returns nullptr on failure. Release with unmapShared.
+template<typename T>
+T* mapShared() {
+    void* memory = mmap(nullptr, sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return nullptr;
+    return static_cast<T*>(memory);
+}
+
+template<typename T>
+void unmapShared(T* shared) {
+    if (shared) munmap(shared, sizeof(T));
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+// Functions to detect the NUMA topology and pin worker threads to CPUs,
+// filling one node before the next. Tables are not replicated per node.
+
+// Structure to represent the CPUs of each NUMA node
+struct CpuTopology {
+    vector<vector<int>> nodeCpus;
+
+    int numNodes() const {
+        return static_cast<int>(nodeCpus.size());
+    }
+
+    int numCpus() const {
+        int total = 0;
+        for (const auto& cpus : nodeCpus) total += static_cast<int>(cpus.size());
+        return total;
+    }
+};
+
+// Function to parse a kernel CPU list such as "0-3,8,10-11"
+inline vector<int> parseCpuList(const string& list) {
+    vector<int> cpus;
+    stringstream ss(list);
+    string range;
+    while (getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        size_t dash = range.find('-');
+        try {
+            int first = stoi(range.substr(0, dash));
+            int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        }
+        catch (const exception&) {
+            // Ignore malformed entries
+        }
+    }
+    return cpus;
+}
+
+// Function to read the NUMA topology from sysfs; without NUMA information
+// every online CPU is reported as node 0
+inline CpuTopology detectCpuTopology() {
+    CpuTopology topology;
+    for (int node = 0;; ++node) {
+        ifstream file("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        if (!file.is_open()) break;
+        string list;
+        getline(file, list);
+        vector<int> cpus = parseCpuList(list);
+        if (!cpus.empty()) topology.nodeCpus.push_back(cpus);
+    }
+
+    if (topology.nodeCpus.empty()) {
+        vector<int> cpus;
+        ifstream online("/sys/devices/system/cpu/online");
+        string list;
+        if (online.is_open() && getline(online, list)) cpus = parseCpuList(list);
+        if (cpus.empty()) {
+            for (unsigned c = 0; c < max(1u, thread::hardware_concurrency()); ++c)
+                cpus.push_back(static_cast<int>(c));
+        }
+        topology.nodeCpus.push_back(cpus);
+    }
+    return topology;
+}
+
+// Function to pin the calling thread to the CPU for the given worker slot.
+// Slots fill node 0's CPUs first, then node 1's, and wrap around.
+inline bool pinCurrentThread(const CpuTopology& topology, int workerIndex) {
+    int slot = workerIndex % max(1, topology.numCpus());
+    for (int node = 0; node < topology.numNodes(); ++node) {
+        int nodeSize = static_cast<int>(topology.nodeCpus[node].size());
+        if (slot >= nodeSize) {
+            slot -= nodeSize;
+            continue;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(topology.nodeCpus[node][slot], &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+    return false;
+}